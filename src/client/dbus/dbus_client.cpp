@@ -14,7 +14,7 @@
 
 #include <QtDBus/QDBusConnection>
 #include <QtDBus/QDBusReply>
-#include <QDBusInterface>
+#include <QtDBus/QDBusPendingCallWatcher>
 #include <kcomponentdata.h>
 #include <kstandarddirs.h>
 #include <knotification.h>
@@ -27,13 +27,32 @@
 #include <kio/job.h>
 #include <klocalizedstring.h>
 #include "client/dbus/dbus_client.h"
+#include "client/dbus/dbus_registry.h"
 #include "utility/exception.h"
+#include "utility/trace.h"
+#include "utility/instrumentation.h"
 
 using namespace KIO;
 using namespace KIO_CLIPBOARD;
 
+// timeout in milliseconds and maximum number of attempts of a single request that may be repeated
 const int timeout = 5000;
-const int repeat = 6;
+const int repeat = 2;
+
+/*!
+ * isTimeout
+ * @brief Tells whether a request failed because its reply did not arrive in time.
+ * @param error error a pending request resulted in
+ * @return true for a timeout, false for any other error
+ * A timeout does not tell whether the service has executed the request or not.
+ * @author Christian Reiner
+ */
+static bool isTimeout ( const QDBusError& error )
+{
+  return    QDBusError::NoReply==error.type()
+         || QDBusError::Timeout==error.type()
+         || QDBusError::TimedOut==error.type();
+} // isTimeout
 
 /*!
  * DBusClient::DBusClient
@@ -42,35 +61,49 @@ const int repeat = 6;
  * @param path dbus specific component path
  * @param interface dbus interface
  * Since this is a generic proxy there is not too much to setup.
- * Only thing is the interface object itself. 
+ * Only thing is to check the interface object, that is shared with all other clients of this process.
+ * @see DBusRegistry
  * @author Christian Reiner
  */
 DBusClient::DBusClient ( const QString& service, const QString& path, const QString& interface )
+  : m_service   ( service )
+  , m_path      ( path )
+  , m_interface ( interface )
 {
   kDebug() << "constructing generic DBus client";
   kDebug() << service, path, interface;
-  // setup bus connection details
-  QDBusConnection _bus = QDBusConnection::sessionBus();
-  this->m_interface = new QDBusInterface ( service, path, interface, _bus );
-  if ( ! this->m_interface->isValid() )
-    if  ( ! this->m_interface->lastError().isValid() )
+  // setup bus connection details, the proxy is requested again for every use, see DBusRegistry
+  const QDBusAbstractInterface* _interface = DBusRegistry::instance().interface ( service, path, interface );
+  if ( ! _interface->isValid() )
+    if  ( ! _interface->lastError().isValid() )
       throw Exception ( Error(ERR_INTERNAL) );
     else
-      throw Exception ( Error(ERR_INTERNAL), this->m_interface->lastError().message() );
+      throw Exception ( Error(ERR_INTERNAL), _interface->lastError().message() );
   kDebug() << "connection to DBus successful.";
 }
 
 /*!
  * DBusClient::~DBusClient
  * @brief Destructor of class DBusClient. 
+ * The interface object is owned by the registry, so it is not destroyed here.
  * @author Christian Reiner
  */
 DBusClient::~DBusClient ( )
 {
   kDebug() << "destructing generic DBus client";
-  delete this->m_interface;
 }
 
+/*!
+ * DBusClient::requestTimeout
+ * @brief Timeout applied to all requests.
+ * @return timeout in milliseconds
+ * @author Christian Reiner
+ */
+int DBusClient::requestTimeout ( )
+{
+  return timeout;
+} // DBusClient::requestTimeout
+
 /*!
  * DBusClient::resultSize
  * @brief Read-only access to the result a request produced. 
@@ -112,22 +145,145 @@ int DBusClient::resultSize ( )
  */
 QVariant& DBusClient::convertReturnValue ( QVariant &variant, QVariant::Type _t )
 {
-  kDebug() << QVariant::typeToName(_t);
+  kTrace(T_DBUS) << QVariant::typeToName(_t);
   if ( ! variant.canConvert(_t) )
   {
-    kDebug() << QString("trying to interpret variant of type '%1' as '%2' !?!").arg(variant.typeName()).arg(QVariant::typeToName(_t));
+    kTrace(T_DBUS) << QString("trying to interpret variant of type '%1' as '%2' !?!").arg(variant.typeName()).arg(QVariant::typeToName(_t));
     throw Exception ( Error(ERR_INTERNAL), QVariant::typeToName(_t) );
   }
   if ( ! variant.convert(_t) )
   {
-    kDebug() << QString("conversion of variant to type '%1' failed !").arg(QVariant::typeToName(_t));
+    kTrace(T_DBUS) << QString("conversion of variant to type '%1' failed !").arg(QVariant::typeToName(_t));
     throw Exception ( Error(ERR_SLAVE_DEFINED), QVariant::typeToName(_t) );
   }
   return variant;
 } // DBusClient::readReturnValue
 
 /*!
- * DBusClient::called
+ * DBusClient::message
+ * @brief Prepares a request to the service, interface and object this client is bound to.
+ * @param method name of the method to be called
+ * @param args list of dbus arguments
+ * @return message ready to be sent
+ * @author Christian Reiner
+ */
+QDBusMessage DBusClient::message ( const QString& method, const QList<QVariant>& args ) const
+{
+  QDBusMessage _msg = QDBusMessage::createMethodCall ( m_service, m_path, m_interface, method );
+  _msg.setArguments ( args );
+  return _msg;
+} // DBusClient::message
+
+/*!
+ * DBusClient::asyncCall
+ * @brief Sends a request without waiting for its reply.
+ * @param message request as prepared by DBusClient::message
+ * @return pending call, a handle to the future reply
+ * Any number of requests can be in flight, the service handles them in the order they have been sent.
+ * @see DBusClient::wait
+ * @author Christian Reiner
+ */
+QDBusPendingCall DBusClient::asyncCall ( const QDBusMessage& message ) const
+{
+  kTrace(T_DBUS) << message.member() << message.arguments().size() << "arguments";
+  return DBusRegistry::instance().connection().asyncCall ( message, timeout );
+} // DBusClient::asyncCall
+
+/*!
+ * DBusClient::asyncCall
+ * @brief Sends a request and reports its reply to a callback.
+ * @param message request as prepared by DBusClient::message
+ * @param receiver object to receive the reply
+ * @param slot slot taking a QDBusPendingCallWatcher*, it is responsible for deleting the watcher
+ * @return watcher that emits its finished signal when the reply has arrived
+ * The callback requires an event loop to be processed, without that use DBusClient::wait instead.
+ * @author Christian Reiner
+ */
+QDBusPendingCallWatcher* DBusClient::asyncCall ( const QDBusMessage& message, QObject* receiver, const char* slot ) const
+{
+  QDBusPendingCallWatcher* _watcher = new QDBusPendingCallWatcher ( asyncCall(message), receiver );
+  QObject::connect ( _watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), receiver, slot );
+  return _watcher;
+} // DBusClient::asyncCall
+
+/*!
+ * DBusClient::settle
+ * @brief Waits for a pending request and decides whether it has to be repeated.
+ * @param pending pending call as returned by DBusClient::asyncCall or by a typed proxy
+ * @param method name of the method called, only used for reporting
+ * @param attempt number of the attempt this request is, counting from 1
+ * @return true if the reply has arrived, false if the request timed out and should be sent again
+ * Any other error, as well as a timeout of the last attempt allowed, is reported right away as an exception.
+ * Only meant for idempotent requests like getters: a request that timed out might have been executed nevertheless,
+ * so repeating a request that changes something might apply that change twice. Those are waited for by conclude().
+ * @see DBusClient::conclude
+ * @author Christian Reiner
+ */
+bool DBusClient::settle ( QDBusPendingCall& pending, const QString& method, int attempt ) const
+{
+  InstrumentationTimer _timer ( "dbus.", method );
+  pending.waitForFinished ( );
+  if ( ! pending.isError() )
+    return TRUE;
+  if ( attempt>=repeat || ! isTimeout(pending.error()) )
+    throw Exception ( Error(ERR_SLAVE_DEFINED), pending.error().message() );
+  kTrace(T_DBUS) << "repeating request" << method << "after" << pending.error().message();
+  return FALSE;
+} // DBusClient::settle
+
+/*!
+ * DBusClient::conclude
+ * @brief Waits for a pending request that must not be repeated.
+ * @param pending pending call as returned by DBusClient::asyncCall or by a typed proxy
+ * @param method name of the method called, only used for reporting
+ * @return true if the reply has arrived, false if the request timed out
+ * A request that timed out might or might not have been executed by the service, the caller has to find out if that matters.
+ * Any other error is reported right away as an exception.
+ * @see DBusClient::settle
+ * @author Christian Reiner
+ */
+bool DBusClient::conclude ( QDBusPendingCall& pending, const QString& method ) const
+{
+  InstrumentationTimer _timer ( "dbus.", method );
+  pending.waitForFinished ( );
+  if ( ! pending.isError() )
+    return TRUE;
+  if ( ! isTimeout(pending.error()) )
+    throw Exception ( Error(ERR_SLAVE_DEFINED), pending.error().message() );
+  kTrace(T_DBUS) << "request" << method << "timed out:" << pending.error().message();
+  return FALSE;
+} // DBusClient::conclude
+
+/*!
+ * DBusClient::wait
+ * @brief Waits for the reply of a request that has been sent asynchronously.
+ * @param pending pending call as returned by DBusClient::asyncCall, replaced in case the request is repeated
+ * @param message the request itself, required to repeat it
+ * @param idempotent true if executing the request more than once does no harm
+ * @return list of QVariants holding the requests result
+ * An idempotent request that timed out is sent again, up to a limited number of times.
+ * Any other request fails on its first timeout, it might have been executed nevertheless.
+ * Any other error is reported right away, since repeating the request would not change anything.
+ * @author Christian Reiner
+ */
+QList<QVariant> DBusClient::wait ( QDBusPendingCall& pending, const QDBusMessage& message, bool idempotent ) const
+{
+  if ( ! idempotent )
+  {
+    if ( ! conclude(pending,message.member()) )
+      throw Exception ( Error(ERR_SLAVE_DEFINED), pending.error().message() );
+  }
+  else
+    for ( int _attempt=1; ! settle(pending,message.member(),_attempt); _attempt++ )
+      pending = asyncCall ( message );
+  const QDBusMessage _reply = pending.reply ( );
+  if ( QDBusMessage::ReplyMessage!=_reply.type() )
+    throw Exception ( Error(ERR_SLAVE_DEFINED), i18n("DBus call did not result in a reply message.") );
+  return _reply.arguments();
+} // DBusClient::wait
+
+/*!
+ * DBusClient::call
  * @brief Generic wrapper of an actual request (call) to DBus. 
  * @param arg1 first dbus argument
  * @param arg2 second dbus argument
@@ -139,6 +295,8 @@ QVariant& DBusClient::convertReturnValue ( QVariant &variant, QVariant::Type _t
  * @param arg8 eigth dbus argument
  * Basic error handling considers protocol and transport problems,
  * but there is no way to deal with the content received as a result. 
+ * This is a request sent asynchronously and waited for immediately, so the timeout applies.
+ * Nothing is known about the method called, so the request is not repeated after a timeout.
  * @author Christian Reiner
  */
 void DBusClient::call ( const QString method, const QVariant & arg1,
@@ -150,13 +308,14 @@ void DBusClient::call ( const QString method, const QVariant & arg1,
                                               const QVariant & arg7,
                                               const QVariant & arg8 )
 {
-  kDebug() << method << arg1 << arg2 << arg3 << arg4 << arg5 << arg6 << arg7 << arg8;
-  QDBusMessage _msg = m_interface->call ( method, arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8 );
-  // error checking
-  if ( QDBusMessage::ErrorMessage==_msg.type() )
-    throw Exception ( Error(ERR_SLAVE_DEFINED), _msg.errorMessage() );
-  if ( QDBusMessage::ReplyMessage!=_msg.type() )
-    throw Exception ( Error(ERR_SLAVE_DEFINED), i18n("DBus call did not result in a reply message.") );
-  m_result = _msg.arguments();
-  kDebug() << QString("read a result holding of %1 entries.").arg(m_result.size());
+  // only valid arguments are passed on, just as QDBusAbstractInterface::call does
+  QList<QVariant> _args;
+  foreach ( const QVariant& _arg, QList<QVariant>() << arg1 << arg2 << arg3 << arg4 << arg5 << arg6 << arg7 << arg8 )
+    if ( _arg.isValid() )
+      _args << _arg;
+  kTrace(T_DBUS) << method << _args.size() << "arguments";
+  const QDBusMessage _msg = message ( method, _args );
+  QDBusPendingCall _pending = asyncCall ( _msg );
+  m_result = wait ( _pending, _msg, FALSE );
+  kTrace(T_DBUS) << QString("read a result holding of %1 entries.").arg(m_result.size());
 } // DBusClient::call
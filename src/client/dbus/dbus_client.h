@@ -18,6 +18,9 @@
 #include <QString>
 #include <QStringList>
 #include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusMessage>
+#include <QtDBus/QDBusPendingCall>
+#include <QtDBus/QDBusAbstractInterface>
 #include <kio/global.h>
 #include <KUrl>
 
@@ -31,6 +34,10 @@ namespace KIO_CLIPBOARD
    * Basic error handling is provided and a few convenience methods. 
    * This class is usually not used by itself in a direct way, instead it should be derived by a
    * specialized client implementing the real functions as declared by the DBus service. 
+   * Requests can be issued asynchronously: several requests can be in flight at the same time,
+   * their replies are collected later on or reported to a callback slot.
+   * All requests are subject to a timeout. Idempotent requests that timed out are repeated a limited number of times,
+   * all others fail right away, since the service might have executed them nevertheless.
    */
   class DBusClient
   {
@@ -40,11 +47,20 @@ namespace KIO_CLIPBOARD
     private:
     protected:
       QList<QVariant> m_result;
-      QDBusInterface* m_interface;
+      const QString   m_service;
+      const QString   m_path;
+      const QString   m_interface;
     public:
+      static int      requestTimeout ( );
       QList<QVariant> result ( );
       int             resultSize ( );
       QVariant& convertReturnValue ( QVariant &variant, QVariant::Type _t );
+      QDBusMessage             message   ( const QString& method, const QList<QVariant>& args=QList<QVariant>() ) const;
+      QDBusPendingCall         asyncCall ( const QDBusMessage& message ) const;
+      QDBusPendingCallWatcher* asyncCall ( const QDBusMessage& message, QObject* receiver, const char* slot ) const;
+      QList<QVariant>          wait      ( QDBusPendingCall& pending, const QDBusMessage& message, bool idempotent ) const;
+      bool                     settle    ( QDBusPendingCall& pending, const QString& method, int attempt ) const;
+      bool                     conclude  ( QDBusPendingCall& pending, const QString& method ) const;
       void      call ( const QString method, const QVariant & arg1 = QVariant(),
                                              const QVariant & arg2 = QVariant(),
                                              const QVariant & arg3 = QVariant(),
@@ -0,0 +1,147 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file
+ * Implements class DBusRegistry. 
+ * @author Christian Reiner
+ */
+
+#include <QtDBus/QDBusServiceWatcher>
+#include <kglobal.h>
+#include <kdebug.h>
+#include "client/dbus/dbus_registry.h"
+
+using namespace KIO_CLIPBOARD;
+
+K_GLOBAL_STATIC ( DBusRegistry, s_dbusRegistry )
+
+/*!
+ * DBusRegistry::instance
+ * @brief Access to the one registry of this process.
+ * @return reference to the registry
+ * The registry is constructed on first access.
+ * @author Christian Reiner
+ */
+DBusRegistry& DBusRegistry::instance ( )
+{
+  return *s_dbusRegistry;
+} // DBusRegistry::instance
+
+/*!
+ * DBusRegistry::DBusRegistry
+ * @brief Constructor of class DBusRegistry
+ * @author Christian Reiner
+ */
+DBusRegistry::DBusRegistry ( )
+  : QObject      ( )
+  , m_connection ( QDBusConnection::sessionBus() )
+{
+  kDebug();
+} // DBusRegistry::DBusRegistry
+
+/*!
+ * DBusRegistry::~DBusRegistry
+ * @brief Destructor of class DBusRegistry
+ * The proxies are children of the application object, they are destroyed together with that,
+ * whilst the connection still exists. The registry itself is destroyed later on, at process exit.
+ * @author Christian Reiner
+ */
+DBusRegistry::~DBusRegistry ( )
+{
+  kDebug();
+} // DBusRegistry::~DBusRegistry
+
+/*!
+ * DBusRegistry::lookup
+ * @brief Finds a registered proxy that is still usable.
+ * @param key key the proxy has been registered under
+ * @return the proxy, 0 if there is none or if it had become invalid, the caller has to create a fresh one then
+ * Callers hold the mutex.
+ * @author Christian Reiner
+ */
+QDBusAbstractInterface* DBusRegistry::lookup ( const QString& key )
+{
+  QDBusAbstractInterface* _interface = m_interfaces.value ( key );
+  if ( _interface && ! _interface->isValid() )
+  {
+    kDebug() << "replacing invalid proxy for" << key;
+    m_interfaces.remove ( key );
+    delete _interface;
+    _interface = 0;
+  }
+  return _interface;
+} // DBusRegistry::lookup
+
+/*!
+ * DBusRegistry::enroll
+ * @brief Registers a freshly created proxy.
+ * @param key key the proxy is registered under
+ * @param service dbus service the proxy talks to
+ * @param interface the proxy
+ * Owner changes of the service are watched from the first proxy of that service on.
+ * A service is watched by a single watcher for the lifetime of the registry, even if its proxies are dropped and created again.
+ * Callers hold the mutex.
+ * @author Christian Reiner
+ */
+void DBusRegistry::enroll ( const QString& key, const QString& service, QDBusAbstractInterface* interface )
+{
+  m_interfaces.insert ( key, interface );
+  if ( ! m_watched.contains(service) )
+  {
+    QDBusServiceWatcher* _watcher = new QDBusServiceWatcher ( service, m_connection, QDBusServiceWatcher::WatchForOwnerChange, this );
+    connect ( _watcher, SIGNAL(serviceOwnerChanged(QString,QString,QString)), this, SLOT(serviceOwnerChanged(QString,QString,QString)) );
+    m_watched.insert ( service );
+  }
+  m_services.insert ( key, service );
+} // DBusRegistry::enroll
+
+/*!
+ * DBusRegistry::serviceOwnerChanged
+ * @brief Drops all proxies of a service that has been restarted or has gone.
+ * @param service dbus service whose owner changed
+ * @param oldOwner unique name of the previous owner
+ * @param newOwner unique name of the current owner, empty if the service has gone
+ * The notification is delivered whenever the slave processes events, fresh proxies are created on the next request.
+ * @author Christian Reiner
+ */
+void DBusRegistry::serviceOwnerChanged ( const QString& service, const QString& oldOwner, const QString& newOwner )
+{
+  kDebug() << service << oldOwner << "=>" << newOwner;
+  QMutexLocker _locker ( &m_mutex );
+  foreach ( const QString& _key, m_services.keys(service) )
+  {
+    delete m_interfaces.take ( _key );
+    m_services.remove ( _key );
+  }
+} // DBusRegistry::serviceOwnerChanged
+
+/*!
+ * DBusRegistry::interface
+ * @brief Delivers the proxy for a DBus object and interface, it is created on first request.
+ * @param service dbus specific service namespace
+ * @param path dbus specific component path
+ * @param interface dbus interface
+ * @return proxy to the requested interface, owned by the registry, only valid until the next request
+ * @author Christian Reiner
+ */
+QDBusAbstractInterface* DBusRegistry::interface ( const QString& service, const QString& path, const QString& interface )
+{
+  const QString _key = QString("%1 %2 %3").arg(service).arg(path).arg(interface);
+  QMutexLocker _locker ( &m_mutex );
+  QDBusAbstractInterface* _interface = lookup ( _key );
+  if ( 0==_interface )
+  {
+    kDebug() << "creating proxy for" << _key;
+    _interface = new DBusProxy ( service, path, interface.toLatin1().constData(), m_connection, QCoreApplication::instance() );
+    enroll ( _key, service, _interface );
+  }
+  return _interface;
+} // DBusRegistry::interface
+
+#include "client/dbus/dbus_registry.moc"
@@ -0,0 +1,102 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file
+ * Declares class DBusRegistry. 
+ * @author Christian Reiner
+ */
+
+#ifndef DBUS_REGISTRY_H
+#define DBUS_REGISTRY_H
+
+#include <QString>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QCoreApplication>
+#include <QObject>
+#include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusAbstractInterface>
+
+namespace KIO_CLIPBOARD
+{
+  /*!
+   * @class DBusProxy
+   * A plain proxy to a DBus object
+   * Other than a QDBusInterface this proxy does not introspect the remote object when constructed,
+   * which is a blocking round-trip to the service. That description is not required anyway, since
+   * all requests are sent as messages carrying the method name and arguments.
+   */
+  class DBusProxy
+    : public QDBusAbstractInterface
+  {
+    public:
+      inline DBusProxy ( const QString& service, const QString& path, const char* interface, const QDBusConnection& connection, QObject* parent=0 )
+        : QDBusAbstractInterface ( service, path, interface, connection, parent ) { };
+  }; // class DBusProxy
+
+  /*!
+   * @class DBusRegistry
+   * Per process registry of DBus proxies
+   * Every client talking to the same object through the same interface shares a single proxy.
+   * The proxies are created on first request, they all use the session bus.
+   * A proxy created whilst its service was not running stays invalid, slaves run no event loop that could let it recover.
+   * So an invalid proxy is replaced by a fresh one when requested, just as the proxies of a service that changed its owner.
+   * Clients must not hold on to a proxy, they request it from the registry for every use. That is a plain hash lookup.
+   * There is exactly one registry per process, it is created lazily on first usage, the construction is thread-safe.
+   */
+  class DBusRegistry
+    : public QObject
+  {
+    Q_OBJECT
+    private:
+      QDBusConnection                         m_connection;
+      QMutex                                  m_mutex;
+      QHash<QString,QDBusAbstractInterface*> m_interfaces;
+      QHash<QString,QString>                  m_services;
+      QSet<QString>                           m_watched;
+      QDBusAbstractInterface* lookup   ( const QString& key );
+      void                    enroll   ( const QString& key, const QString& service, QDBusAbstractInterface* interface );
+    private slots:
+      void serviceOwnerChanged ( const QString& service, const QString& oldOwner, const QString& newOwner );
+    public:
+      static DBusRegistry& instance ( );
+      DBusRegistry ( );
+      ~DBusRegistry ( );
+      inline const QDBusConnection& connection ( ) const { return m_connection; };
+      QDBusAbstractInterface* interface ( const QString& service, const QString& path, const QString& interface );
+      template<class Interface> Interface* interface ( const QString& service, const QString& path );
+  }; // class DBusRegistry
+
+  /*!
+   * DBusRegistry::interface
+   * @brief Delivers a typed proxy as generated from an interface description, it is created on first request.
+   * @param service dbus specific service namespace
+   * @param path dbus specific component path
+   * @return proxy to the requested object, owned by the registry, only valid until the next request
+   * Typed proxies are registered apart from the plain ones of the same interface, the key holds the class name.
+   * @author Christian Reiner
+   */
+  template<class Interface> Interface* DBusRegistry::interface ( const QString& service, const QString& path )
+  {
+    const QString _key = QString("%1 %2 %3").arg(service).arg(path).arg(Interface::staticMetaObject.className());
+    QMutexLocker _locker ( &m_mutex );
+    Interface* _interface = static_cast<Interface*> ( lookup(_key) );
+    if ( 0==_interface )
+    {
+      _interface = new Interface ( service, path, m_connection, QCoreApplication::instance() );
+      enroll ( _key, service, _interface );
+    }
+    return _interface;
+  } // DBusRegistry::interface
+
+} // namespace KIO_CLIPBOARD
+
+#endif // DBUS_REGISTRY_H
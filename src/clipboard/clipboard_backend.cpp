@@ -29,6 +29,7 @@ using namespace KIO_CLIPBOARD;
  */
 ClipboardBackend::ClipboardBackend ( QObject* parent )
   : QObject ( parent )
+  , m_cancelled ( FALSE )
 {
   kDebug() << "constructing specialized DBus client of type 'klipper'";
 } // ClipboardBackend::ClipboardBackend
@@ -43,4 +44,28 @@ ClipboardBackend::~ClipboardBackend ()
   kDebug() << "destructing specialized DBus client of type 'klipper'";
 } // ClipboardBackend::~ClipboardBackend
 
+/*!
+ * ClipboardBackend::getClipboardHistoryDigests
+ * @brief Retrieves digests of all entries available in the clipboard, newest first.
+ * @return list of digests, one per entry in history order
+ * Only available for clipboards offering the capability CAP_DIGESTS.
+ * @author Christian Reiner
+ */
+QList<ClipboardDigest> ClipboardBackend::getClipboardHistoryDigests ( )
+{
+  throw Exception ( Error(ERR_UNSUPPORTED_ACTION), "getClipboardHistoryDigests" );
+} // ClipboardBackend::getClipboardHistoryDigests
+
+/*!
+ * ClipboardBackend::getClipboardGeneration
+ * @brief Retrieves the generation of the clipboard content, a counter changing with every change of the history.
+ * @return generation counter
+ * Only available for clipboards offering the capability CAP_GENERATION.
+ * @author Christian Reiner
+ */
+int ClipboardBackend::getClipboardGeneration ( )
+{
+  throw Exception ( Error(ERR_UNSUPPORTED_ACTION), "getClipboardGeneration" );
+} // ClipboardBackend::getClipboardGeneration
+
 #include "clipboard/clipboard_backend.moc"
@@ -24,19 +24,46 @@ class QDBusInterface;
 using namespace KIO;
 namespace KIO_CLIPBOARD
 {
+  /*!
+   * ClipboardDigest
+   * @brief Short description of a clipboard entry, allows to recognize an entry without transferring its payload.
+   * The hash is computed by the clipboard, its algorithm does not matter as long as it is stable.
+   * @author Christian Reiner
+   */
+  struct ClipboardDigest
+  {
+    QString hash;
+    int     size;
+  };
+
   /*!
    * class ClipboardBackend
    * @brief Generic clipboard backend wrapper. 
+   * Lengthy operations report their progress, a receiver of that signal may cancel the operation.
+   * Clipboards may offer optional capabilities that save transferring the whole history on every refresh:
+   * - CAP_DIGESTS: the history can be listed as digests, so only payloads of unknown entries have to be transferred
+   * - CAP_GENERATION: the clipboard counts its changes, so an unchanged history does not have to be listed at all
+   * Clipboards lacking those capabilities are listed completely every time.
    * @author Christian Reiner
    */
   class ClipboardBackend
     : public QObject
   {
     Q_OBJECT
+    public:
+      enum Capability { CAP_NONE=0x0, CAP_DIGESTS=0x1, CAP_GENERATION=0x2 };
+    protected:
+      bool m_cancelled;
     public:
       ClipboardBackend ( QObject* parent=0 );
       ~ClipboardBackend ( );
+      virtual int                    capabilities               () const { return CAP_NONE; };
+      virtual QList<ClipboardDigest> getClipboardHistoryDigests ();
+      virtual int                    getClipboardGeneration     ();
+    signals:
+      void progress ( int processed, int total );
     public slots:
+      inline void         cancel                  () { m_cancelled = TRUE; };
       virtual void        clearClipboardContents  () = 0;
       virtual void        clearClipboardHistory   () = 0;
       virtual QString     getClipboardContents    () = 0;
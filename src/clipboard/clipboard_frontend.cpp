@@ -14,16 +14,20 @@
  */
 
 #include <math.h>
+#include <QDataStream>
 #include <kdebug.h>
 #include <kurl.h>
 #include <kmimetype.h>
 #include <kio/netaccess.h>
 #include <kshareddatacache.h>
+#include <kstandarddirs.h>
 #include <kdatetime.h>
 #include "utility/exception.h"
 #include "protocol/kio_clipboard_protocol.h"
 #include "clipboard/clipboard_frontend.h"
 #include "clipboard/klipper/klipper_frontend.h"
+#include "utility/trace.h"
+#include "utility/instrumentation.h"
 
 using namespace KIO;
 using namespace KIO_CLIPBOARD;
@@ -93,10 +97,26 @@ ClipboardFrontend::ClipboardFrontend ( const KUrl& url, const QString& name )
   , m_mappingNameCardinality ( KIO_CLIPBOARD::C_mappingNameCardinality ) 
   , m_mappingNameLength      ( KIO_CLIPBOARD::C_mappingNameLength )
   , m_mappingNamePattern     ( KIO_CLIPBOARD::C_mappingNamePattern )
+  , m_mappingNameHash        ( KIO_CLIPBOARD::C_mappingNameHash )
+  , m_mimetypeSniffLength    ( KIO_CLIPBOARD::C_mimetypeSniffLength )
+  , m_backend     ( 0 )
+  , m_cacheHits   ( 0 )
+  , m_cacheMisses ( 0 )
+  , m_tableDirty  ( FALSE )
+  , m_generation  ( 0 )
+  , m_publishedGeneration ( 0 )
+  , m_tracker     ( 0 )
+  , m_trackedGeneration ( -1 )
+  , m_backendGeneration ( -1 )
 {
   kDebug();
+  // names end up in urls users keep (bookmarks, recent documents), so they are md5 hashes just like those of older versions
+  // the faster murmur3 hash has to be chosen explicitly, knowing that all urls kept so far become invalid by that
+  if ( "murmur3"==qgetenv("KIO_CLIPBOARD_NAME_HASH").toLower() )
+    m_mappingNameHash = H_MURMUR3;
   m_cache = new KSharedDataCache ( QString("kio-clipboard-%1").arg(m_name), 100*1024*1024, 256 );
   m_cache->setEvictionPolicy ( KSharedDataCache::EvictOldest );
+  m_table = new NodeTable ( KStandardDirs::locateLocal("tmp",QString("kio-clipboard-%1.nodes").arg(m_name)) );
   m_nodes = new NodeList;
 } // ClipboardFrontend::ClipboardFrontend
 
@@ -109,7 +129,11 @@ ClipboardFrontend::ClipboardFrontend ( const KUrl& url, const QString& name )
 ClipboardFrontend::~ClipboardFrontend ( )
 {
   kDebug();
+  publishClassifications ( );
+  publishNodes ( );
   clearNodes();
+  delete m_tracker;
+  delete m_table;
   delete m_cache;
   delete m_nodes;
 } // ClipboardFrontend::~ClipboardFrontend
@@ -145,9 +169,9 @@ const UDSEntry ClipboardFrontend::toUDSEntry ( ) const
 const UDSEntryList ClipboardFrontend::toUDSEntryList ( ) const
 {
   UDSEntryList _entries;
-  foreach ( const NodeWrapper* _entry, m_nodes->toMap() )
+  foreach ( const NodeWrapper* _entry, m_nodes->positions() )
     _entries << _entry->toUDSEntry();
-  kDebug() << "listing" << _entries.count() << "entries";
+  kTrace(T_LIST) << "listing" << _entries.count() << "entries";
   return _entries;
 } // ClipboardFrontend::toUDSEntryList
 
@@ -156,31 +180,299 @@ const UDSEntryList ClipboardFrontend::toUDSEntryList ( ) const
  * @brief Refreshes all nodes (clipboard entries) curently contained in the clipboard wrapper.
  * Since we buffer the clipboards entries in a map of objects we have to refresh that map from time to time. 
  * Since changes in clipboards often can only be detected by polling this has to be done quite frequent. 
+ * Therefore the refresh works incremental: nodes are keyed by the hash of their payload (see NodeWrapper::payload2name),
+ * so nodes of unchanged entries are kept, only their position gets fixed. Only new entries are classified. 
+ * A fresh slave starts off with the nodes published by another slave, see seedNodes().
  * @author: Christian Reiner
  */
 void ClipboardFrontend::refreshNodes ( )
 {
-  kDebug();
+  kTrace(T_LIST);
+  InstrumentationTimer _timer ( "frontend.refresh" );
+  int _generation = -1;
+  if ( m_tracker )
+  {
+    m_tracker->poll ( );
+    _generation = m_tracker->generation ( );
+  }
+  // a fresh slave starts off with the nodes another slave has published
+  if ( m_nodes->isEmpty() )
+    seedNodes ( _generation );
+  // nothing to do if the clipboard is known not to have changed since the last refresh
+  if ( -1!=_generation && _generation==m_trackedGeneration )
+  {
+    kTrace(T_LIST) << "clipboard unchanged since generation" << _generation << ", keeping nodes";
+    return;
+  }
+  // clipboards counting their changes tell us themselves
+  int _backendGeneration = -1;
+  if ( m_backend->capabilities() & ClipboardBackend::CAP_GENERATION )
+  {
+    _backendGeneration = m_backend->getClipboardGeneration ( );
+    if ( -1!=_backendGeneration && _backendGeneration==m_backendGeneration )
+    {
+      kTrace(T_LIST) << "clipboard reports unchanged generation" << _backendGeneration << ", keeping nodes";
+      return;
+    }
+  }
+  // pick up what other slaves have published since
+  m_table->attach ( );
   // ask the specialised client for the entries
-  QStringList _entries = getClipboardEntries ( );
+  // the generation has been taken before, so a change happening meanwhile leads to another refresh next time
+  QStringList _entries = fetchEntries ( );
+  m_trackedGeneration = _generation;
+  m_backendGeneration = _backendGeneration;
   // update global name cardinality, important to construct names with correct cardinality of their name prefix indexes
   m_mappingNameCardinality = QString("%1").arg(_entries.count()).size();
-  kDebug() << QString("set mapping cardinality to %1 (length of numeric index)").arg(C_mappingNameCardinality);
-  // strategy: clear the nodes before (re-) populating it
-  m_nodes->clear();
-  // now populate the nodes, one entry after another
+  kTrace(T_LIST) << QString("set mapping cardinality to %1 (length of numeric index)").arg(m_mappingNameCardinality);
+  // strategy: move nodes of entries still present into a fresh list, create nodes only for new entries
+  NodeList* _nodes = new NodeList;
+  _nodes->reserve ( _entries.count() );
+  bool _changed = ( _entries.count()!=m_nodes->count() );
   int _index = 0;
+  int _created = 0;
   foreach ( const QString& _entry, _entries )
   {
-    NodeWrapper* _node = new NodeWrapper ( this, ++_index, _entry );
-    m_nodes->insert ( _node->name(), _node );
+    ++_index;
+    const QString _name = NodeWrapper::payload2name ( _entry, m_mappingNameHash );
+    // identical payloads map to the same node, the newest (first) entry wins
+    if ( _nodes->contains(_name) )
+      continue;
+    // the frontend owns its nodes, so it is allowed to fix their position
+    NodeWrapper* _node = const_cast<NodeWrapper*> ( m_nodes->value(_name) );
+    if ( 0==_node )
+    {
+      _node = new NodeWrapper ( this, _index, _entry );
+      ++_created;
+      _changed = TRUE;
+    }
+    else if ( _index!=_node->index() || m_mappingNameCardinality!=_node->nameCardinality() )
+    {
+      _node->setPosition ( _index, m_mappingNameCardinality );
+      _changed = TRUE;
+    }
+    _nodes->append ( _name, _node );
   }
-  kDebug() << "populated fresh set of nodes with" << m_nodes->size ( ) << "entries";
-  // store refreshed list into shared cache
-  m_cache->clear ( );
-  m_cache->insert ( "nodes", m_nodes->toJSON() );
+  // whatever has not been moved over into the fresh list has vanished from the clipboard
+  foreach ( const NodeWrapper* _node, m_nodes->positions() )
+    if ( _node!=_nodes->value(_node->name()) )
+    {
+      delete _node;
+      _changed = TRUE;
+    }
+  delete m_nodes;
+  m_nodes = _nodes;
+  instrumentCount ( "nodes.built",  _created );
+  instrumentCount ( "nodes.reused", m_nodes->size()-_created );
+  kTrace(T_LIST) << "refreshed set of nodes holding" << m_nodes->size ( ) << "entries," << _created << "of them new";
+  kTrace(T_CACHE) << "classification cache:" << m_cacheHits << "hits," << m_cacheMisses << "misses";
+  // keep the history itself, payloads are served from there
+  m_entries = _entries;
+  // nodes are not stored in the shared cache right here: serializing them would classify every single one
+  // they are published once a listing has classified them, see publishNodes()
+  if ( _changed )
+    ++m_generation;
 } // ClipboardFrontend::refreshNodes
 
+/*!
+ * ClipboardFrontend::seedNodes
+ * @brief Takes over the nodes another slave has published in the shared cache.
+ * @param generation current generation of the clipboard as tracked, -1 if unknown
+ * If the snapshot has been taken in the current generation the history is known to be unchanged since,
+ * so it does not even have to be transferred. Otherwise the nodes serve as a base for the incremental refresh,
+ * which only has to classify entries not present in the snapshot. Snapshots that cannot be read are ignored.
+ * Data left by older versions in their JSON notation is accepted as a base too.
+ * @see ClipboardFrontend::publishNodes
+ * @author: Christian Reiner
+ */
+void ClipboardFrontend::seedNodes ( int generation )
+{
+  InstrumentationTimer _timer ( "frontend.seed" );
+  QByteArray _data;
+  qint32 _generation = -1;
+  if ( m_cache->find("snapshot",&_data) )
+  {
+    QDataStream _stream ( _data );
+    _stream >> _generation;
+    _data = _data.mid ( sizeof(qint32) );
+  }
+  else if ( ! m_cache->find("nodes",&_data) )
+    return;
+  try
+  {
+    m_nodes->fromSnapshot ( _data );
+  }
+  catch ( Exception &e )
+  {
+    kTrace(T_CACHE) << "ignoring unusable snapshot:" << e.getText();
+    return;
+  }
+  kTrace(T_CACHE) << "seeded" << m_nodes->size() << "nodes of generation" << _generation;
+  if ( m_nodes->isEmpty() || -1==generation || generation!=_generation )
+    return;
+  m_trackedGeneration      = _generation;
+  m_mappingNameCardinality = m_nodes->at(0)->nameCardinality ( );
+  m_publishedGeneration    = ++m_generation;
+} // ClipboardFrontend::seedNodes
+
+/*!
+ * ClipboardFrontend::publishNodes
+ * @brief Stores a snapshot of the current nodes in the shared cache, so a fresh slave can start off with them.
+ * The snapshot holds the tracked generation of the clipboard it has been taken in.
+ * Nothing is stored if the nodes have been published before or if any of them has not been classified yet:
+ * serializing a node classifies it, this must not be done for nodes no one has asked for.
+ * @see ClipboardFrontend::seedNodes
+ * @author: Christian Reiner
+ */
+void ClipboardFrontend::publishNodes ( )
+{
+  if ( m_generation==m_publishedGeneration )
+    return;
+  foreach ( const NodeWrapper* _node, m_nodes->positions() )
+    if ( ! _node->isClassified() )
+      return;
+  InstrumentationTimer _timer ( "frontend.snapshot" );
+  QByteArray _data;
+  QDataStream _stream ( &_data, QIODevice::WriteOnly );
+  _stream << qint32(m_trackedGeneration);
+  _data.append ( m_nodes->toSnapshot() );
+  m_cache->insert ( "snapshot", _data );
+  m_publishedGeneration = m_generation;
+} // ClipboardFrontend::publishNodes
+
+/*!
+ * ClipboardFrontend::fetchEntries
+ * @brief Retrieves all entries of the clipboard, newest first.
+ * @return string list holding all entries available in the clipboard
+ * Clipboards able to list digests of their entries only have to transfer payloads of entries not seen before,
+ * all others are asked for the complete history.
+ * @author: Christian Reiner
+ */
+QStringList ClipboardFrontend::fetchEntries ( )
+{
+  if ( ! (m_backend->capabilities() & ClipboardBackend::CAP_DIGESTS) )
+    return getClipboardEntries ( );
+  QHash<QString,QString> _digests;
+  QStringList _entries;
+  int _index = 0;
+  int _fetched = 0;
+  foreach ( const ClipboardDigest& _digest, m_backend->getClipboardHistoryDigests() )
+  {
+    ++_index;
+    QHash<QString,QString>::const_iterator _known = m_digests.constFind ( _digest.hash );
+    if ( m_digests.constEnd()!=_known && _digest.size==_known.value().size() )
+      _entries << _known.value();
+    else
+    {
+      _entries << getClipboardEntry ( _index );
+      ++_fetched;
+    }
+    _digests.insert ( _digest.hash, _entries.last() );
+  }
+  // only digests of entries still present are kept
+  m_digests = _digests;
+  kTrace(T_LIST) << "listed" << _entries.size() << "digests, fetched" << _fetched << "payloads";
+  return _entries;
+} // ClipboardFrontend::fetchEntries
+
+/*!
+ * ClipboardFrontend::getNodePayload
+ * @brief Delivers the payload of a node.
+ * @param node node whose payload is requested
+ * @return payload of the node
+ * The whole history has been transferred when the nodes were refreshed, so the payload is usually taken from that snapshot.
+ * Since the history might have changed in the meantime the payload is only accepted if it matches the nodes name (the payload hash).
+ * Otherwise the single entry is requested from the clipboard and checked the same way.
+ * If that fails too the entry has moved, then the nodes are refreshed and the entry is looked up by its name again.
+ * The refresh deletes nodes no longer present, that might include the node handed in.
+ * So callers must not use that node after this call returns, but look it up again by its name.
+ * @author: Christian Reiner
+ */
+QString ClipboardFrontend::getNodePayload ( const NodeWrapper* node )
+{
+  kTrace(T_LIST) << node->name() << "at index" << node->index() << "of generation" << m_generation;
+  // copies, the node must not be touched once the nodes have been refreshed
+  const QString _name     = node->name();
+  const int     _index    = node->index();
+  const int     _position = _index - 1;
+  // the snapshot of the current generation
+  if ( _position>=0 && _position<m_entries.size() && _name==NodeWrapper::payload2name(m_entries.at(_position),m_mappingNameHash) )
+    return m_entries.at ( _position );
+  // the live history, at the position the node had when the nodes were refreshed
+  const QString _payload = getClipboardEntry ( _index );
+  if ( _name==NodeWrapper::payload2name(_payload,m_mappingNameHash) )
+    return _payload;
+  // the entry has moved, so refresh the snapshot and find it again, the node object might be gone then
+  kTrace(T_LIST) << "stale entry index, refreshing nodes";
+  invalidateNodes ( );
+  refreshNodes ( );
+  const NodeWrapper* _node = m_nodes->value ( _name );
+  if ( 0==_node )
+    throw Exception ( Error(ERR_DOES_NOT_EXIST), _name );
+  return m_entries.at ( _node->index()-1 );
+} // ClipboardFrontend::getNodePayload
+
+/*!
+ * ClipboardFrontend::findClassification
+ * @brief Looks up the classification of a node in the cache shared between all slave processes.
+ * @param name name of the node, this is the hash of its payload
+ * @param data reference that receives the serialized classification
+ * @return true if the cache holds a classification for that node
+ * Classifying an entry (mime type detection, pattern matching) is expensive.
+ * Since the result only depends on the payload every process can reuse what another process has found out before.
+ * @see NodeWrapper::toClassification
+ * @author: Christian Reiner
+ */
+bool ClipboardFrontend::findClassification ( const QString& name, QByteArray& data )
+{
+  if ( m_table->find(name,data) || m_cache->find(QString("node-%1").arg(name),&data) )
+  {
+    ++m_cacheHits;
+    instrumentCount ( "cache.hits" );
+    return TRUE;
+  }
+  ++m_cacheMisses;
+  instrumentCount ( "cache.misses" );
+  return FALSE;
+} // ClipboardFrontend::findClassification
+
+/*!
+ * ClipboardFrontend::insertClassification
+ * @brief Stores the classification of a node in the cache shared between all slave processes.
+ * @param name name of the node, this is the hash of its payload
+ * @param data serialized classification
+ * @see NodeWrapper::fromClassification
+ * @author: Christian Reiner
+ */
+void ClipboardFrontend::insertClassification ( const QString& name, const QByteArray& data )
+{
+  m_cache->insert ( QString("node-%1").arg(name), data );
+  m_tableDirty = TRUE;
+} // ClipboardFrontend::insertClassification
+
+/*!
+ * ClipboardFrontend::publishClassifications
+ * @brief Adds the classifications of the current nodes to the node table shared by all slave processes.
+ * Only nodes that have been classified already and are missing in the table are published, publishing does not trigger any classification.
+ * Nothing is written unless this process has classified a node itself since the table was written last.
+ * The table is mapped read-only by all slaves, so its content is held in memory once, not once per slave as in the cache lookups.
+ * @see NodeTable
+ * @author: Christian Reiner
+ */
+void ClipboardFrontend::publishClassifications ( )
+{
+  if ( ! m_tableDirty )
+    return;
+  InstrumentationTimer _timer ( "frontend.publish" );
+  QMap<QString,QByteArray> _classifications;
+  QByteArray _published;
+  foreach ( const NodeWrapper* _node, m_nodes->positions() )
+    if ( _node->isClassified() && ! m_table->find(_node->name(),_published) )
+      _classifications.insert ( _node->name(), _node->toClassification() );
+  if ( _classifications.isEmpty() || m_table->write(_classifications) )
+    m_tableDirty = FALSE;
+} // ClipboardFrontend::publishClassifications
+
 /*!
  * ClipboardFrontend::clearNodes
  * @brief: Clears all nodes (clipboard entries) currently contained in the clipboard wrapper.
@@ -191,8 +483,9 @@ void ClipboardFrontend::refreshNodes ( )
 void ClipboardFrontend::clearNodes ( )
 {
   kDebug();
-  foreach ( const NodeWrapper* const& _entry, m_nodes->values() )
+  foreach ( const NodeWrapper* const& _entry, m_nodes->positions() )
     delete _entry;
+  m_nodes->clear ( );
 } // ClipboardFrontend::clearNodes
 
 /*!
@@ -205,7 +498,7 @@ void ClipboardFrontend::clearNodes ( )
  */
 const NodeWrapper* ClipboardFrontend::findNodeByUrl ( const KUrl& url )
 {
-  kDebug() << url.prettyUrl();
+  kTrace(T_LIST) << url.prettyUrl();
   // note: we might have a fresh process...
   // TODO: find some way of really caching thing between different processes (KDED ? )
   if ( m_nodes->isEmpty() )
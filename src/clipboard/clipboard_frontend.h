@@ -19,14 +19,18 @@
 #include <QObject>
 #include <QString>
 #include <QMap>
+#include <QHash>
 #include <QStringList>
 #include <kio/global.h>
 #include <kio/jobclasses.h>
 #include <kio/udsentry.h>
 #include "utility/regex.h"
+#include "utility/hash.h"
 #include "clipboard/klipper/klipper_backend.h"
 #include "node/node_wrapper.h"
 #include "node/node_list.h"
+#include "node/node_table.h"
+#include "clipboard/clipboard_tracker.h"
 
 class KSharedDataCache;
 
@@ -69,9 +73,24 @@ namespace KIO_CLIPBOARD
       int               m_mappingNameCardinality;
       const int         m_mappingNameLength;
       const QString&    m_mappingNamePattern;
+      PayloadHash       m_mappingNameHash;
+      const int         m_mimetypeSniffLength;
       ClipboardBackend* m_backend;
       KSharedDataCache* m_cache;
+      int               m_cacheHits;
+      int               m_cacheMisses;
+      NodeTable*        m_table;
+      bool              m_tableDirty;
       NodeList*         m_nodes;
+      QStringList       m_entries;
+      int               m_generation;
+      int               m_publishedGeneration;
+      ClipboardTracker* m_tracker;
+      int               m_trackedGeneration;
+      int               m_backendGeneration;
+      QHash<QString,QString> m_digests;
+      QStringList fetchEntries ( );
+      void seedNodes ( int generation );
     public:
       static QList<const ClipboardFrontend*> detectClipboards ( );
       ClipboardFrontend ( const KUrl& url, const QString& name );
@@ -84,7 +103,18 @@ namespace KIO_CLIPBOARD
       inline const int      mappingNameCardinality ( ) const { return m_mappingNameCardinality; };
       inline const int      mappingNameLength      ( ) const { return m_mappingNameLength; };
       inline const QString& mappingNamePattern     ( ) const { return m_mappingNamePattern; };
-      inline int countNodes ( ) { return m_nodes->size(); };
+      inline PayloadHash    mappingNameHash        ( ) const { return m_mappingNameHash; };
+      inline const int      mimetypeSniffLength    ( ) const { return m_mimetypeSniffLength; };
+      inline ClipboardBackend* backend  ( ) const { return m_backend; };
+      inline int             countNodes ( )       { return m_nodes->size(); };
+      inline const NodeList& nodes      ( ) const { return *m_nodes; };
+      inline int cacheHits   ( ) const { return m_cacheHits; };
+      inline int cacheMisses ( ) const { return m_cacheMisses; };
+      inline int generation  ( ) const { return m_generation;  };
+      bool findClassification   ( const QString& name, QByteArray& data );
+      void insertClassification ( const QString& name, const QByteArray& data );
+      void publishClassifications ( );
+      void publishNodes ( );
       const NodeWrapper*    findNodeByUrl  ( const KUrl& url );
       const UDSEntry        toUDSEntry     ( ) const;
       const UDSEntryList    toUDSEntryList ( ) const;
@@ -93,6 +123,8 @@ namespace KIO_CLIPBOARD
       virtual QStringList   getClipboardEntries ( ) = 0;
       virtual void          pushEntry ( const QString& entry ) = 0;
       virtual void          delEntry  ( const KUrl& url      ) = 0;
+      QString getNodePayload ( const NodeWrapper* node );
+      inline void invalidateNodes ( ) { m_trackedGeneration = -1; m_backendGeneration = -1; };
       void refreshNodes ( );
       void clearNodes ( );
   }; // class ClipboardFrontend
@@ -0,0 +1,197 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Implementation of class ClipboardTracker
+ * @see ClipboardTracker
+ * @author Christian Reiner
+ */
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusMessage>
+#include <QtDBus/QDBusServiceWatcher>
+#include <kdirnotify.h>
+#include <kdebug.h>
+#include "clipboard/clipboard_tracker.h"
+
+using namespace KIO;
+using namespace KIO_CLIPBOARD;
+
+// timeout in milliseconds of the introspection, a hanging clipboard must not hold up the slave for long
+static const int C_introspectionTimeout = 1000;
+
+/*!
+ * ClipboardTracker::ClipboardTracker
+ * @brief Constructor of class ClipboardTracker
+ * @param url url of the clipboard, views showing this url are told about changes
+ * @param key key of the shared memory segment holding the generation counter, unique per clipboard
+ * @param service dbus service of the clipboard
+ * @param path dbus object path of the clipboard
+ * @param interface dbus interface declaring the change signal
+ * @param signal name of the change signal
+ * @param parent parent object
+ * Older versions of a clipboard might not emit any change signal, so its presence is checked by introspection first.
+ * The introspection is tried once with a short timeout, tracking is simply disabled if the clipboard does not answer.
+ * A restart of the clipboard service counts as a change, the history is most likely different afterwards.
+ * @author Christian Reiner
+ */
+ClipboardTracker::ClipboardTracker ( const KUrl& url, const QString& key,
+                                     const QString& service, const QString& path, const QString& interface, const QString& signal,
+                                     QObject* parent )
+  : QObject    ( parent )
+  , m_url      ( url )
+  , m_counter  ( key )
+  , m_tracking ( FALSE )
+  , m_changed  ( FALSE )
+  , m_seen     ( 0 )
+{
+  kDebug() << service << path << interface << signal;
+  QDBusConnection _bus = QDBusConnection::sessionBus ( );
+  const QDBusMessage _request = QDBusMessage::createMethodCall ( service, path, "org.freedesktop.DBus.Introspectable", "Introspect" );
+  const QDBusMessage _reply   = _bus.call ( _request, QDBus::Block, C_introspectionTimeout );
+  if ( QDBusMessage::ReplyMessage!=_reply.type() || _reply.arguments().isEmpty() )
+  {
+    kDebug() << "failed to introspect service" << service << ", tracking disabled:" << _reply.errorMessage();
+    return;
+  }
+  if ( ! _reply.arguments().first().toString().contains(QString("<signal name=\"%1\"").arg(signal)) )
+  {
+    kDebug() << "service" << service << "does not offer signal" << signal << ", tracking disabled";
+    return;
+  }
+  if ( ! attachCounter() )
+  {
+    kDebug() << "failed to share the generation counter, tracking disabled:" << m_counter.errorString();
+    return;
+  }
+  m_tracking = _bus.connect ( service, path, interface, signal, this, SLOT(changed()) );
+  if ( m_tracking )
+  {
+    QDBusServiceWatcher* _watcher = new QDBusServiceWatcher ( service, _bus, QDBusServiceWatcher::WatchForOwnerChange, this );
+    connect ( _watcher, SIGNAL(serviceOwnerChanged(QString,QString,QString)), this, SLOT(changed()) );
+  }
+  m_seen = generation ( );
+  kDebug() << "tracking changes:" << m_tracking;
+} // ClipboardTracker::ClipboardTracker
+
+/*!
+ * ClipboardTracker::~ClipboardTracker
+ * @brief Destructor of class ClipboardTracker
+ * @author Christian Reiner
+ */
+ClipboardTracker::~ClipboardTracker ( )
+{
+  kDebug();
+} // ClipboardTracker::~ClipboardTracker
+
+/*!
+ * ClipboardTracker::initialGeneration
+ * @brief Generation a newly created counter starts from.
+ * @return positive generation, leaving room for a billion changes before it overflows
+ * The segment vanishes with the last slave, the next slave starts counting anew. Snapshots of the nodes outlive the slaves
+ * in the cache, so a counter starting from 0 again would soon claim a snapshot of a former run as current.
+ * Starting from the clock instead makes that practically impossible.
+ * @author Christian Reiner
+ */
+qint32 ClipboardTracker::initialGeneration ( )
+{
+  return 1 + ( QDateTime::currentDateTime().toTime_t() % 0x100000 ) * 1000 + QTime::currentTime().msec();
+} // ClipboardTracker::initialGeneration
+
+/*!
+ * ClipboardTracker::attachCounter
+ * @brief Attaches to the shared generation counter, creating it if no other slave did so before.
+ * @return true if the counter is usable
+ * A newly created segment holds zeros, whoever takes the lock first then initializes the counter.
+ * @author Christian Reiner
+ */
+bool ClipboardTracker::attachCounter ( )
+{
+  if ( ! m_counter.attach() && ! m_counter.create(sizeof(qint32)) )
+  {
+    // another slave might have created the segment in the meantime
+    if ( QSharedMemory::AlreadyExists!=m_counter.error() || ! m_counter.attach() )
+      return FALSE;
+  }
+  if ( ! m_counter.lock() )
+    return FALSE;
+  qint32* _generation = static_cast<qint32*> ( m_counter.data() );
+  if ( 0==*_generation )
+    *_generation = initialGeneration ( );
+  m_counter.unlock ( );
+  return TRUE;
+} // ClipboardTracker::attachCounter
+
+/*!
+ * ClipboardTracker::generation
+ * @brief Current generation of the clipboard content.
+ * @return generation counter, -1 if changes are not tracked, so the generation cannot be trusted
+ * @author Christian Reiner
+ */
+int ClipboardTracker::generation ( ) const
+{
+  if ( ! m_tracking )
+    return -1;
+  QSharedMemory& _counter = const_cast<QSharedMemory&> ( m_counter );
+  if ( ! _counter.lock() )
+    return -1;
+  const qint32 _generation = *static_cast<const qint32*> ( _counter.constData() );
+  _counter.unlock ( );
+  return _generation;
+} // ClipboardTracker::generation
+
+/*!
+ * ClipboardTracker::poll
+ * @brief Receives change signals that have arrived in the meantime and counts the change they announce.
+ * A slave does not run an event loop whilst waiting for commands, so signals are queued until this is called.
+ * Any number of signals received at once count as a single change.
+ * Every slave alive receives each signal. If the generation has moved on since this slave looked at it last,
+ * another slave has counted the change already. Then only the generation is taken over, views have been notified before.
+ * Otherwise this slave is the first to notice, so it increments the generation and notifies views showing the clipboard.
+ * Comparing and incrementing happens under the lock of the counter, so exactly one slave counts a change.
+ * A slave whose nodes are older than the current generation refreshes anyway, so no change can be missed this way.
+ * @author Christian Reiner
+ */
+void ClipboardTracker::poll ( )
+{
+  if ( ! m_tracking )
+    return;
+  QCoreApplication::processEvents ( QEventLoop::ExcludeUserInputEvents );
+  if ( ! m_changed )
+    return;
+  m_changed = FALSE;
+  if ( ! m_counter.lock() )
+    return;
+  qint32* _generation = static_cast<qint32*> ( m_counter.data() );
+  const bool _counted = ( *_generation!=m_seen );
+  if ( ! _counted )
+    ++*_generation;
+  m_seen = *_generation;
+  m_counter.unlock ( );
+  if ( _counted )
+  {
+    kDebug() << "clipboard change counted by another slave already, generation" << m_seen;
+    return;
+  }
+  kDebug() << "clipboard changed, generation" << m_seen;
+  OrgKdeKDirNotifyInterface::emitFilesAdded ( m_url.url() );
+} // ClipboardTracker::poll
+
+/*!
+ * ClipboardTracker::changed
+ * @brief Registers a change of the clipboard content, it is counted by the next poll().
+ * @author Christian Reiner
+ */
+void ClipboardTracker::changed ( )
+{
+  m_changed = TRUE;
+} // ClipboardTracker::changed
+
+#include "clipboard/clipboard_tracker.moc"
@@ -0,0 +1,67 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Declaration of class ClipboardTracker
+ * @see ClipboardTracker
+ * @author Christian Reiner
+ */
+
+#ifndef CLIPBOARD_TRACKER_H
+#define CLIPBOARD_TRACKER_H
+
+#include <QObject>
+#include <QString>
+#include <QSharedMemory>
+#include <KUrl>
+
+namespace KIO_CLIPBOARD
+{
+  /*!
+   * class ClipboardTracker
+   * @brief Keeps track of changes of a clipboard by listening to the change signal the clipboard emits on DBus.
+   * Each change increments a generation counter held in a small shared memory segment of its own, shared between all slave processes.
+   * The counter is kept apart from the cache of the nodes, an eviction of that cache must not reset it.
+   * Reading and incrementing the counter is guarded by the lock of the segment, so two slaves cannot count the same change twice.
+   * A slave only has to transfer the history again when the generation differs from the one its nodes have been built from.
+   * In addition views showing the clipboard are told to update by means of KDirNotify.
+   * Signals are delivered from the event loop, a slave has to call poll() to receive them.
+   * Note that slaves run no event loop whilst idle, so changes are only noticed when a slave handles its next command.
+   * Views are therefore notified deferred, not right when the change happens; that would require a kded module.
+   * Every live slave receives the signal, but only the first one to notice a change counts it and notifies views.
+   * Tracking is only active if the clipboard announces the signal in its introspection data,
+   * otherwise the generation is never valid and the clipboard has to be queried every time.
+   * @author Christian Reiner
+   */
+  class ClipboardTracker
+    : public QObject
+  {
+    Q_OBJECT
+    private:
+      const KUrl        m_url;
+      QSharedMemory     m_counter;
+      bool              m_tracking;
+      bool              m_changed;
+      int               m_seen;
+      bool attachCounter ( );
+      static qint32 initialGeneration ( );
+    public:
+      ClipboardTracker ( const KUrl& url, const QString& key,
+                         const QString& service, const QString& path, const QString& interface, const QString& signal,
+                         QObject* parent=0 );
+      ~ClipboardTracker ( );
+      inline bool isTracking ( ) const { return m_tracking; };
+      int  generation ( ) const;
+      void poll ( );
+    public slots:
+      void changed ( );
+  }; // class ClipboardTracker
+
+} // namespace KIO_CLIPBOARD
+
+#endif // CLIPBOARD_TRACKER_H
@@ -14,28 +14,38 @@
  * @author Christian Reiner
  */
 
-#include <QDBusInterface>
-#include <QDBusReply>
+#include <QtDBus/QDBusPendingReply>
 #include <QStringList>
 #include <kio/global.h>
 #include <kdebug.h>
 #include <klocalizedstring.h>
 #include "clipboard/klipper/klipper_backend.h"
+#include "client/dbus/dbus_registry.h"
+#include "klipper_interface.h"
 #include "utility/exception.h"
+#include "utility/trace.h"
 
 using namespace KIO;
 using namespace KIO_CLIPBOARD;
 
+// maximum number of requests in flight when populating the history
+const int window = 64;
+// maximum number of rounds when populating the history, a new round starts after a request timed out
+const int rounds = 3;
+
 /*!
  * KlipperBackend::KlipperBackend
  * @brief Constructor of the backend part of the specialized clipboard wrapper.
  * @param parent
  * DBusClient is the abstract communication client used in background. 
+ * Requests are sent through a typed proxy generated from klippers interface description at build time,
+ * so arguments and results are not converted to and from variants.
  * @author Christian Reiner
  */
 KlipperBackend::KlipperBackend ( QObject* parent )
   : ClipboardBackend ( parent )
   , DBusClient ( "org.kde.klipper", "/klipper", "org.kde.klipper.klipper" )
+  , m_capabilities ( -1 )
 {
   kDebug() << "constructing specialized DBus client of type 'klipper'";
 } // KlipperBackend::KlipperBackend
@@ -43,6 +53,7 @@ KlipperBackend::KlipperBackend ( QObject* parent )
 /*!
  * KlipperBackend::~KlipperBackend
  * @brief Destructor of the backend part of the clipboard wrapper.
+ * The proxy is owned by the registry, so it is not destroyed here.
  * @author Christian Reiner
  */
 KlipperBackend::~KlipperBackend ( )
@@ -50,6 +61,95 @@ KlipperBackend::~KlipperBackend ( )
   kDebug() << "destructing specialized DBus client of type 'klipper'";
 } // KlipperBackend::~KlipperBackend
 
+/*!
+ * KlipperBackend::klipper
+ * @brief Typed proxy to klipper.
+ * @return proxy as handed out by the registry, only valid until the next request
+ * The proxy is requested for every use, so it is replaced when klipper has been restarted.
+ * @see DBusRegistry
+ * @author Christian Reiner
+ */
+OrgKdeKlipperKlipperInterface* KlipperBackend::klipper ( ) const
+{
+  OrgKdeKlipperKlipperInterface* _klipper = DBusRegistry::instance().interface<OrgKdeKlipperKlipperInterface> ( "org.kde.klipper", "/klipper" );
+#if QT_VERSION >= 0x040800
+  _klipper->setTimeout ( requestTimeout() );
+#endif
+  return _klipper;
+} // KlipperBackend::klipper
+
+/*!
+ * KlipperBackend::capabilities
+ * @brief Optional capabilities offered by the clipboard service.
+ * @return combination of ClipboardBackend::Capability flags
+ * The service is introspected on the first request, the outcome is kept for the lifetime of the backend.
+ * A service not answering is taken to offer nothing, it is asked again next time.
+ * @author Christian Reiner
+ */
+int KlipperBackend::capabilities ( ) const
+{
+  if ( -1!=m_capabilities )
+    return m_capabilities;
+  const QDBusMessage _request = QDBusMessage::createMethodCall ( m_service, m_path, "org.freedesktop.DBus.Introspectable", "Introspect" );
+  const QDBusMessage _reply   = DBusRegistry::instance().connection().call ( _request, QDBus::Block, requestTimeout() );
+  if ( QDBusMessage::ReplyMessage!=_reply.type() || _reply.arguments().isEmpty() )
+  {
+    kTrace(T_DBUS) << "failed to introspect" << m_service << ":" << _reply.errorMessage();
+    return CAP_NONE;
+  }
+  const QString _description = _reply.arguments().first().toString ( );
+  m_capabilities = CAP_NONE;
+  if ( _description.contains("<method name=\"getClipboardHistoryDigests\"") )
+    m_capabilities |= CAP_DIGESTS;
+  if ( _description.contains("<method name=\"getClipboardGeneration\"") )
+    m_capabilities |= CAP_GENERATION;
+  kTrace(T_DBUS) << m_service << "offers capabilities" << m_capabilities;
+  return m_capabilities;
+} // KlipperBackend::capabilities
+
+/*!
+ * KlipperBackend::getClipboardHistoryDigests
+ * @brief Retrieves digests of all entries available in the clipboard, newest first.
+ * @return list of digests, one per entry in history order
+ * The service describes each entry by its hash and its size in characters, separated by a blank.
+ * Only available for services offering the capability CAP_DIGESTS.
+ * @author Christian Reiner
+ */
+QList<ClipboardDigest> KlipperBackend::getClipboardHistoryDigests ( )
+{
+  kTrace(T_DBUS);
+  const QDBusMessage _message = message ( "getClipboardHistoryDigests" );
+  QDBusPendingCall _pending = asyncCall ( _message );
+  const QList<QVariant> _result = wait ( _pending, _message, TRUE );
+  QList<ClipboardDigest> _digests;
+  foreach ( const QString& _description, _result.value(0).toStringList() )
+  {
+    ClipboardDigest _digest;
+    _digest.hash = _description.section ( ' ', 0, 0 );
+    _digest.size = _description.section ( ' ', 1, 1 ).toInt ( );
+    _digests << _digest;
+  }
+  kTrace(T_DBUS) << QString("clipboard returned %1 digests").arg(_digests.size());
+  return _digests;
+} // KlipperBackend::getClipboardHistoryDigests
+
+/*!
+ * KlipperBackend::getClipboardGeneration
+ * @brief Retrieves the generation of the clipboard content, a counter changing with every change of the history.
+ * @return generation counter
+ * Only available for services offering the capability CAP_GENERATION.
+ * @author Christian Reiner
+ */
+int KlipperBackend::getClipboardGeneration ( )
+{
+  kTrace(T_DBUS);
+  const QDBusMessage _message = message ( "getClipboardGeneration" );
+  QDBusPendingCall _pending = asyncCall ( _message );
+  const int _generation = wait(_pending,_message,TRUE).value(0).toInt ( );
+  kTrace(T_DBUS) << "clipboard reports generation" << _generation;
+  return _generation;
+} // KlipperBackend::getClipboardGeneration
+
 /*!
  * KlipperBackend::clearClipboardContents
  * @brief Clears the currently active clipboard content. 
@@ -57,8 +157,10 @@ KlipperBackend::~KlipperBackend ( )
  */
 void KlipperBackend::clearClipboardContents ( )
 {
-  kDebug();
-  m_interface->call ( "clearClipboardContents" );
+  kTrace(T_DBUS);
+  QDBusPendingReply<> _reply = klipper()->clearClipboardContents ( );
+  if ( ! conclude(_reply,"clearClipboardContents") )
+    throw Exception ( Error(ERR_SLAVE_DEFINED), i18n("Klipper did not answer in time, the request might not have been executed.") );
 } // KlipperBackend::clearClipboardContents
 
 /*!
@@ -68,8 +170,10 @@ void KlipperBackend::clearClipboardContents ( )
  */
 void KlipperBackend::clearClipboardHistory ( )
 {
-  kDebug();
-  m_interface->call ( "clearClipboardHistory" );
+  kTrace(T_DBUS);
+  QDBusPendingReply<> _reply = klipper()->clearClipboardHistory ( );
+  if ( ! conclude(_reply,"clearClipboardHistory") )
+    throw Exception ( Error(ERR_SLAVE_DEFINED), i18n("Klipper did not answer in time, the request might not have been executed.") );
 } // KlipperBackend::clearClipboardHistory
 
 /*!
@@ -80,12 +184,12 @@ void KlipperBackend::clearClipboardHistory ( )
  */
 QString KlipperBackend::getClipboardContents ( )
 {
-  kDebug();
-  call ( "getClipboardContents" );
-  if ( 1 != m_result.size() )
-    throw Exception ( Error(ERR_INTERNAL), i18n("DBus call did not return a single entry as expected.") );
-  QString _entry = convertReturnValue(m_result.first(),QVariant::String).toString();
-  kDebug() << QString("read clipboard content '%1%2'").arg(_entry.left(25)).arg((25>_entry.size())?"[...]":"");
+  kTrace(T_DBUS);
+  QDBusPendingReply<QString> _reply = klipper()->getClipboardContents ( );
+  for ( int _attempt=1; ! settle(_reply,"getClipboardContents",_attempt); _attempt++ )
+    _reply = klipper()->getClipboardContents ( );
+  const QString _entry = _reply.value ( );
+  kTrace(T_DBUS) << QString("read clipboard content '%1%2'").arg(_entry.left(25)).arg((25>_entry.size())?"[...]":"");
   return _entry;
 } // KlipperBackend::getClipboardContents
 
@@ -97,10 +201,12 @@ QString KlipperBackend::getClipboardContents ( )
  */
 QStringList KlipperBackend::getClipboardHistoryMenu ( )
 {
-  kDebug();
-  call ( "getClipboardHistoryMenu" );
-  QStringList _entries = convertReturnValue(m_result.first(),QVariant::StringList).toStringList();
-  kDebug() << QString("clipboard returned list holding %1 entries").arg(_entries.count());
+  kTrace(T_DBUS);
+  QDBusPendingReply<QStringList> _reply = klipper()->getClipboardHistoryMenu ( );
+  for ( int _attempt=1; ! settle(_reply,"getClipboardHistoryMenu",_attempt); _attempt++ )
+    _reply = klipper()->getClipboardHistoryMenu ( );
+  const QStringList _entries = _reply.value ( );
+  kTrace(T_DBUS) << QString("clipboard returned list holding %1 entries").arg(_entries.count());
   return _entries;
 } // KlipperBackend::getClipboardHistoryMenu
 
@@ -113,12 +219,12 @@ QStringList KlipperBackend::getClipboardHistoryMenu ( )
  */
 QString KlipperBackend::getClipboardHistoryItem ( int index )
 {
-  kDebug() << index << "/" << index-1; // the dbus service counts from 0, not from 1
-  call ( "getClipboardHistoryItem", index-1 );
-  if ( 1 != m_result.size() )
-    throw Exception ( Error(ERR_INTERNAL), i18n("DBus call did not return a single entry as expected.") );
-  QString _entry = convertReturnValue(m_result.first(),QVariant::String).toString();
-  kDebug() << QString("read clipboard history item #%1: '%2%3'").arg(index).arg(_entry.left(25)).arg((25>_entry.size())?"[...]":"");
+  kTrace(T_DBUS) << index << "/" << index-1; // the dbus service counts from 0, not from 1
+  QDBusPendingReply<QString> _reply = klipper()->getClipboardHistoryItem ( index-1 );
+  for ( int _attempt=1; ! settle(_reply,"getClipboardHistoryItem",_attempt); _attempt++ )
+    _reply = klipper()->getClipboardHistoryItem ( index-1 );
+  const QString _entry = _reply.value ( );
+  kTrace(T_DBUS) << QString("read clipboard history item #%1: '%2%3'").arg(index).arg(_entry.left(25)).arg((25>_entry.size())?"[...]":"");
   return _entry;
 } // KlipperBackend::getClipboardHistoryItem
 
@@ -130,24 +236,90 @@ QString KlipperBackend::getClipboardHistoryItem ( int index )
  */
 void KlipperBackend::setClipboardContents ( const QString& entry )
 {
-  kDebug() << entry;
-  call ( "setClipboardContents", entry );
+  kTrace(T_DBUS) << entry.size() << "characters";
+  QDBusPendingReply<> _reply = klipper()->setClipboardContents ( entry );
+  if ( ! conclude(_reply,"setClipboardContents") )
+    throw Exception ( Error(ERR_SLAVE_DEFINED), i18n("Klipper did not answer in time, the request might not have been executed.") );
 } // KlipperBackend::setClipboardContents
 
 /*!
  * KlipperBackend::setClipboardHistory
  * @brief Replaces all clipboard entries by a list of new ones.
- * @param entries string list of new entries to be set in the clipboard
+ * @param entries string list of new entries to be set in the clipboard, oldest first
+ * Entries are pushed one by one, so the last entry in the list ends up as the current clipboard content.
+ * If klipper already holds the leading part of the list in the same order only the remaining entries are pushed.
+ * The requests do not depend on each others results, so they are sent without waiting for replies,
+ * only the number of requests in flight is limited. Klipper handles them in the order they have been sent.
+ * Requests are never repeated: one that timed out might have been executed nevertheless, repeating it could duplicate an entry.
+ * Instead sending stops and every request still in flight is concluded. If all of those are answered klipper is alive,
+ * the history it actually holds is read again and populating resumes from there. Klipper handles requests in order,
+ * so once that history arrives the request that timed out has been handled too, even if it was the only one in flight.
+ * That also copes with entries pushed twice, the history is no prefix of the list then.
+ * Progress is reported after each reply, a receiver of that signal may cancel the operation.
+ * Requests already sent are completed in that case, the history then holds only part of the entries.
  * @author Christian Reiner
  */
 void KlipperBackend::setClipboardHistory ( const QStringList& entries )
 {
-  // strategy: remove all entries and re-add everything in the correct order
-  kDebug();
-  call ( "clearClipboardHistory" );
-  foreach ( const QString& _entry, entries )
-    call ( "setClipboardContents", _entry );
-  kDebug() << QString("populated clipboard history with %1 entries").arg(entries.size());
+  kTrace(T_DBUS) << entries.size() << "entries";
+  m_cancelled = FALSE;
+  int _skipped   = 0;
+  int _leading   = 0;
+  int _processed = 0;
+  bool _complete = FALSE;
+  for ( int _round=1; ! _complete; _round++ )
+  {
+    // klipper lists its history newest first, so reverse it to compare it with the list of entries
+    QStringList _history;
+    foreach ( const QString& _entry, getClipboardHistoryMenu() )
+      _history.prepend ( _entry );
+    // strategy: keep what is already in place, otherwise remove all entries and re-add everything in the correct order
+    // each request is described by the position of the entry to be pushed, -1 stands for clearing the history
+    QList<int> _requests;
+    _skipped = 0;
+    if ( _history.size()<=entries.size() && _history==entries.mid(0,_history.size()) )
+      _skipped = _history.size();
+    else
+      _requests << -1;
+    _leading = _requests.size();
+    for ( int _position=_skipped; _position<entries.size(); _position++ )
+      _requests << _position;
+    kTrace(T_DBUS) << "round" << _round << ": skipping" << _skipped << "entries already present";
+    // keep a limited window of requests in flight, wait for the oldest one before sending the next
+    QList<QDBusPendingReply<> > _pending;
+    int _sent = 0;
+    bool _timedOut = FALSE;
+    _processed = 0;
+    while ( _processed<_requests.size() )
+    {
+      while ( ! m_cancelled && _sent<_requests.size() && _sent-_processed<window )
+      {
+        const int _request = _requests.at ( _sent++ );
+        _pending << ( (-1==_request) ? klipper()->clearClipboardHistory() : klipper()->setClipboardContents(entries.at(_request)) );
+      }
+      if ( _processed==_sent )
+        break;
+      const int _request = _requests.at ( _processed++ );
+      if ( ! conclude(_pending.first(),(-1==_request)?"clearClipboardHistory":"setClipboardContents") )
+      {
+        // nothing more is sent, every request still in flight is concluded, none of them must be left behind
+        _timedOut = TRUE;
+        bool _answered = TRUE;
+        for ( int _other=1; _other<_pending.size(); _other++ )
+          if ( ! conclude(_pending[_other],(-1==_requests.at(_processed-1+_other))?"clearClipboardHistory":"setClipboardContents") )
+            _answered = FALSE;
+        if ( ! _answered || _round>=rounds )
+          throw Exception ( Error(ERR_SLAVE_DEFINED), i18n("Klipper did not answer in time whilst populating the clipboard history.") );
+        break;
+      }
+      _pending.removeFirst ( );
+      emit progress ( _processed, _requests.size() );
+    }
+    _complete = m_cancelled || ! _timedOut;
+  }
+  if ( m_cancelled )
+    throw Exception ( Error(ERR_USER_CANCELED), i18n("Populating the clipboard history has been cancelled after %1 of %2 entries.", _skipped+qMax(0,_processed-_leading), entries.size()) );
+  kTrace(T_DBUS) << QString("populated clipboard history with %1 entries").arg(entries.size());
 } // KlipperBackend::setClipboardHistory
 
 #include "clipboard/klipper/klipper_backend.moc"
@@ -20,7 +20,7 @@
 #include "client/dbus/dbus_client.h"
 #include "clipboard/clipboard_backend.h"
 
-class QDBusInterface;
+class OrgKdeKlipperKlipperInterface;
 
 using namespace KIO;
 namespace KIO_CLIPBOARD
@@ -31,6 +31,9 @@ namespace KIO_CLIPBOARD
    * @brief The part of the wrapper that implements the specific routines required to use the clipboard. 
    * Communication is done via a separate, abstract client, in this case a DBus client. 
    * So this class maps specific routines onto the abstract client methods. 
+   * Klipper itself offers neither digests nor a generation counter, so its history is always listed completely.
+   * A service offering the methods getClipboardHistoryDigests and getClipboardGeneration on top of klippers interface
+   * is used to its full extent, those capabilities are detected by introspection once they are asked for first.
    * @see ClipboardBackend
    * @author Christian Reiner
    */
@@ -39,9 +42,15 @@ namespace KIO_CLIPBOARD
     , public DBusClient
   {
     Q_OBJECT
+    private:
+      mutable int m_capabilities;
+      OrgKdeKlipperKlipperInterface* klipper ( ) const;
     public:
       KlipperBackend ( QObject* parent=0 );
       ~KlipperBackend ( );
+      int                    capabilities               () const;
+      QList<ClipboardDigest> getClipboardHistoryDigests ();
+      int                    getClipboardGeneration     ();
     public slots:
       void        clearClipboardContents  ();
       void        clearClipboardHistory   ();
@@ -62,6 +62,7 @@ KlipperFrontend::KlipperFrontend ( const KUrl& url, const QString& name )
 {
   kDebug() << "constructing specialized clipboard wrapper of type 'klipper'";
   m_backend = new KlipperBackend ();
+  m_tracker = new ClipboardTracker ( url, QString("kio-clipboard-%1-generation").arg(m_name), "org.kde.klipper", "/klipper", "org.kde.klipper.klipper", "clipboardHistoryUpdated" );
 } // constructor
 
 /*!
@@ -130,6 +131,8 @@ void KlipperFrontend::pushEntry ( const QString& entry )
 {
   kDebug() << entry;
   m_backend->setClipboardContents ( entry );
+  // the change signal for our own change might not have arrived yet
+  invalidateNodes ( );
   refreshNodes ( );
 } // KlipperFrontend::pushEntry
 
@@ -139,10 +142,25 @@ void KlipperFrontend::pushEntry ( const QString& entry )
  * @param url url of the entry to be removed
  * Note that this works random-access, a feature that is not actually offered by the klipper application.
  * We kind of emulate this feature instead by removing all entries and repopulating the clipboard with all entries except that one to be removed.
+ * The backend keeps the entries older than the removed one in place, so only the newer ones are actually pushed again.
+ * The backend reports its progress and can be cancelled, see ClipboardBackend::progress.
  * @author Christian Reiner
  */
 void KlipperFrontend::delEntry ( const KUrl& url )
 {
   kDebug() << url;
-  throw Exception ( Error(ERR_UNSUPPORTED_ACTION), url.prettyUrl() );
+  const QString _name = findNodeByUrl(url)->name ( );
+  // klipper lists its history newest first, repopulating expects the oldest entry first
+  QStringList _entries;
+  bool _found = FALSE;
+  foreach ( const QString& _entry, getClipboardEntries() )
+    if ( _name==NodeWrapper::payload2name(_entry,m_mappingNameHash) )
+      _found = TRUE;
+    else
+      _entries.prepend ( _entry );
+  if ( ! _found )
+    throw Exception ( Error(ERR_DOES_NOT_EXIST), url.prettyUrl() );
+  m_backend->setClipboardHistory ( _entries );
+  invalidateNodes ( );
+  refreshNodes ( );
 } // KlipperFrontend::delEntry
@@ -39,9 +39,6 @@ namespace KIO_CLIPBOARD
   class KlipperFrontend
       : public ClipboardFrontend
   {
-    private:
-    protected:
-      ClipboardBackend* m_backend;
     public:
       static QList<const ClipboardFrontend*> detectClipboards ( DBusClient& dbus );
       KlipperFrontend ( const KUrl& url, const QString& name );
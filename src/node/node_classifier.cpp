@@ -0,0 +1,238 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Implementation of class NodeClassifier
+ * @see NodeClassifier
+ * @author Christian Reiner
+ */
+
+#include <QMutexLocker>
+#include <kglobal.h>
+#include <kdebug.h>
+#include "node/node_classifier.h"
+
+using namespace KIO;
+using namespace KIO_CLIPBOARD;
+
+K_GLOBAL_STATIC ( NodeClassifier, s_nodeClassifier )
+
+/*!
+ * NodeClassifier::instance
+ * @brief Access to the one classifier of this process.
+ * @return reference to the classifier
+ * The classifier is constructed on first access.
+ * @author Christian Reiner
+ */
+const NodeClassifier& NodeClassifier::instance ( )
+{
+  return *s_nodeClassifier;
+} // NodeClassifier::instance
+
+/*!
+ * NodeClassifier::NodeClassifier
+ * @brief Constructor of class NodeClassifier
+ * The automatons are hard wired, so there is nothing to compile or prepare.
+ * @author Christian Reiner
+ */
+NodeClassifier::NodeClassifier ( )
+{
+  kDebug();
+} // NodeClassifier::NodeClassifier
+
+// a few character classes as used in the patterns of the regex catalog
+static inline bool isLower  ( ushort c ) { return c>='a' && c<='z'; }
+static inline bool isDigit  ( ushort c ) { return c>='0' && c<='9'; }
+static inline bool isDomain ( ushort c ) { return isLower(c) || isDigit(c) || '-'==c; }
+static inline bool isQuery  ( ushort c ) { return isLower(c) || isDigit(c) || '_'==c; }
+static inline bool isWord   ( const QChar& c ) { return c.isLetterOrNumber() || c.isMark() || '_'==c.unicode(); }
+
+#define URI_STATE(state) ( Q_UINT64_C(1) << (state) )
+
+/*!
+ * NodeClassifier::stepUri
+ * @brief Advances the automaton of the "uri" pattern by a single character.
+ * @param states set of currently active states
+ * @param c next character of the payload
+ * @return set of states active after consuming the character, an empty set if the payload cannot be an uri
+ * The automaton is a literal translation of the composed "uri" pattern in the regex catalog:
+ * ^((protocol):/{1,3})(user)?(domain)(:port)?(path(query)?(#anchor)?)?$
+ * Since all active states are advanced at the same time there is no backtracking, the scan is linear.
+ * Note that (as in the catalog) the domain separator is a '.' which matches _any_ character.
+ * @author Christian Reiner
+ */
+quint64 NodeClassifier::stepUri ( quint64 states, const QChar& c )
+{
+  const ushort _c = c.unicode();
+  quint64 _next = 0;
+  // protocol: [a-z]{3,9}
+  for ( int _state=U_PROTOCOL0; _state<U_PROTOCOL9; _state++ )
+    if ( (states&URI_STATE(_state)) && isLower(_c) )
+      _next |= URI_STATE(_state+1);
+  if ( ':'==_c && (states&( URI_STATE(U_PROTOCOL3)|URI_STATE(U_PROTOCOL4)|URI_STATE(U_PROTOCOL5)|URI_STATE(U_PROTOCOL6)
+                           |URI_STATE(U_PROTOCOL7)|URI_STATE(U_PROTOCOL8)|URI_STATE(U_PROTOCOL9) )) )
+    _next |= URI_STATE(U_COLON);
+  // separator: :/{1,3}
+  if ( '/'==_c )
+  {
+    if ( states&URI_STATE(U_COLON)  ) _next |= URI_STATE(U_SLASH1);
+    if ( states&URI_STATE(U_SLASH1) ) _next |= URI_STATE(U_SLASH2);
+    if ( states&URI_STATE(U_SLASH2) ) _next |= URI_STATE(U_SLASH3);
+  }
+  // optional user: [^@]+@
+  if ( states&(URI_STATE(U_SLASH1)|URI_STATE(U_SLASH2)|URI_STATE(U_SLASH3)) )
+  {
+    if ( '@'!=_c )      _next |= URI_STATE(U_USER);
+    if ( isDomain(_c) ) _next |= URI_STATE(U_DOMAIN_BLOCK);
+  }
+  if ( states&URI_STATE(U_USER) )
+    _next |= ( '@'==_c ) ? URI_STATE(U_USER_DONE) : URI_STATE(U_USER);
+  if ( (states&URI_STATE(U_USER_DONE)) && isDomain(_c) )
+    _next |= URI_STATE(U_DOMAIN_BLOCK);
+  // domain: ([-a-z0-9]+.)+[a-z]{2,6}
+  if ( states&URI_STATE(U_DOMAIN_BLOCK) )
+  {
+    if ( isDomain(_c) ) _next |= URI_STATE(U_DOMAIN_BLOCK);
+    _next |= URI_STATE(U_DOMAIN_SEPARATOR);
+  }
+  if ( states&URI_STATE(U_DOMAIN_SEPARATOR) )
+  {
+    if ( isDomain(_c) ) _next |= URI_STATE(U_DOMAIN_BLOCK);
+    if ( isLower(_c) )  _next |= URI_STATE(U_TLD1);
+  }
+  for ( int _state=U_TLD1; _state<U_TLD6; _state++ )
+    if ( (states&URI_STATE(_state)) && isLower(_c) )
+      _next |= URI_STATE(_state+1);
+  // optional port: :[0-9]+
+  if ( states&(URI_STATE(U_TLD2)|URI_STATE(U_TLD3)|URI_STATE(U_TLD4)|URI_STATE(U_TLD5)|URI_STATE(U_TLD6)) )
+  {
+    if ( ':'==_c ) _next |= URI_STATE(U_PORT0);
+    if ( '/'==_c ) _next |= URI_STATE(U_PATH_SLASH);
+  }
+  if ( (states&(URI_STATE(U_PORT0)|URI_STATE(U_PORT))) && isDigit(_c) )
+    _next |= URI_STATE(U_PORT);
+  if ( (states&URI_STATE(U_PORT)) && '/'==_c )
+    _next |= URI_STATE(U_PATH_SLASH);
+  // optional path: (/[^/]+)+/?
+  if ( (states&(URI_STATE(U_PATH_SLASH)|URI_STATE(U_PATH_SEGMENT)|URI_STATE(U_PATH_TRAIL))) && '/'!=_c )
+    _next |= URI_STATE(U_PATH_SEGMENT);
+  if ( (states&URI_STATE(U_PATH_SEGMENT)) && '/'==_c )
+    _next |= URI_STATE(U_PATH_TRAIL);
+  // optional query and anchor following the path: ([&?][a-z0-9_]=[^&])*(#\w+)?
+  if ( states&(URI_STATE(U_PATH_SEGMENT)|URI_STATE(U_PATH_TRAIL)|URI_STATE(U_QUERY_DONE)) )
+  {
+    if ( '&'==_c || '?'==_c ) _next |= URI_STATE(U_QUERY1);
+    if ( '#'==_c )            _next |= URI_STATE(U_ANCHOR0);
+  }
+  if ( (states&URI_STATE(U_QUERY1)) && isQuery(_c) ) _next |= URI_STATE(U_QUERY2);
+  if ( (states&URI_STATE(U_QUERY2)) && '='==_c )     _next |= URI_STATE(U_QUERY3);
+  if ( (states&URI_STATE(U_QUERY3)) && '&'!=_c )     _next |= URI_STATE(U_QUERY_DONE);
+  if ( (states&(URI_STATE(U_ANCHOR0)|URI_STATE(U_ANCHOR))) && isWord(c) )
+    _next |= URI_STATE(U_ANCHOR);
+  return _next;
+} // NodeClassifier::stepUri
+
+/*!
+ * NodeClassifier::stepPath
+ * @brief Advances the automaton of the "path" pattern by a single character.
+ * @param state current state
+ * @param c next character of the payload
+ * @return state after consuming the character, P_FAILED if the payload cannot be a path
+ * The automaton is a literal translation of the "path" pattern in the regex catalog: (/[^/]+)+/?
+ * @author Christian Reiner
+ */
+NodeClassifier::PathState NodeClassifier::stepPath ( PathState state, const QChar& c )
+{
+  const bool _slash = ( '/'==c.unicode() );
+  switch ( state )
+  {
+    case P_START:   return _slash ? P_SLASH : P_FAILED;
+    case P_SLASH:   return _slash ? P_FAILED : P_SEGMENT;
+    case P_SEGMENT: return _slash ? P_TRAIL : P_SEGMENT;
+    case P_TRAIL:   return _slash ? P_FAILED : P_SEGMENT;
+    default:        return P_FAILED;
+  }
+} // NodeClassifier::stepPath
+
+/*!
+ * NodeClassifier::semantics
+ * @brief Decides about the sematics ("meaning") of a payload.
+ * @param trimmed payload of the item, stripped of leading and trailing white space
+ * @return one of S_EMPTY, S_URL, S_FILE or S_TEXT
+ * Refinements of the semantics that require the mimetype (like S_CODE) are left to the calling node.
+ * Both automatons are fed in a single pass over the payload, the scan ends as soon as both have failed.
+ * @author Christian Reiner
+ */
+NodeWrapper::Semantics NodeClassifier::semantics ( const QString& trimmed ) const
+{
+  if ( trimmed.isEmpty() )
+    return NodeWrapper::S_EMPTY;
+  const quint64 _accepting = URI_STATE(U_TLD2) | URI_STATE(U_TLD3) | URI_STATE(U_TLD4) | URI_STATE(U_TLD5) | URI_STATE(U_TLD6)
+                           | URI_STATE(U_PORT) | URI_STATE(U_PATH_SEGMENT) | URI_STATE(U_PATH_TRAIL)
+                           | URI_STATE(U_QUERY_DONE) | URI_STATE(U_ANCHOR);
+  quint64   _uri  = URI_STATE(U_PROTOCOL0);
+  PathState _path = P_START;
+  const QChar* _c   = trimmed.constData ( );
+  const QChar* _end = _c + trimmed.size ( );
+  for ( ; _c!=_end; ++_c )
+  {
+    if ( _uri )
+      _uri = stepUri ( _uri, *_c );
+    if ( P_FAILED!=_path )
+      _path = stepPath ( _path, *_c );
+    if ( 0==_uri && P_FAILED==_path )
+      return NodeWrapper::S_TEXT;
+  }
+  if ( _uri&_accepting )
+    return NodeWrapper::S_URL;
+  if ( P_SEGMENT==_path || P_TRAIL==_path )
+    return NodeWrapper::S_FILE;
+  return NodeWrapper::S_TEXT;
+} // NodeClassifier::semantics
+
+/*!
+ * NodeClassifier::mimetype
+ * @brief Detects the mimetype of a textual payload by its content.
+ * @param payload content of the item
+ * @param sniffLength number of leading characters that are inspected
+ * @return detected mimetype
+ * The magic rules of the mimetype system only look at the first few kilobytes of some content.
+ * So there is no point in transcoding a complete payload (that might be several megabytes large), only a prefix is handed over.
+ * @author Christian Reiner
+ */
+KMimeType::Ptr NodeClassifier::mimetype ( const QString& payload, int sniffLength ) const
+{
+  if ( payload.size()<=sniffLength )
+    return KMimeType::findByContent ( payload.toUtf8() );
+  return KMimeType::findByContent ( payload.left(sniffLength).toUtf8() );
+} // NodeClassifier::mimetype
+
+/*!
+ * NodeClassifier::isCode
+ * @brief Decides if a mimetype describes some sort of "code" rather than plain text.
+ * @param mimetype mimetype to be checked
+ * @return true for mimetypes that describe code
+ * Checking a mimetype requires walking its inheritance, so the answer is computed once per mimetype and remembered.
+ * TODO: find some more generic way as an alternative to this list of test for recognized mimetypes
+ * @author Christian Reiner
+ */
+bool NodeClassifier::isCode ( const KMimeType::Ptr& mimetype ) const
+{
+  const QString _name = mimetype->name ( );
+  QMutexLocker _lock ( &m_mutex );
+  QHash<QString,bool>::const_iterator _known = m_code.constFind ( _name );
+  if ( m_code.constEnd()!=_known )
+    return _known.value ( );
+  const bool _code = (  ("text/x-"==_name.left(7))
+                      ||(mimetype->is("text/css"))
+                      ||(mimetype->is("text/html"))
+                      ||(mimetype->is("text/sgml"))
+                      ||(mimetype->is("text/xml")) );
+  m_code.insert ( _name, _code );
+  return _code;
+} // NodeClassifier::isCode
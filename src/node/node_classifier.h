@@ -0,0 +1,75 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Declaration of class NodeClassifier
+ * @see NodeClassifier
+ * @author Christian Reiner
+ */
+
+#ifndef NODE_CLASSIFIER_H
+#define NODE_CLASSIFIER_H
+
+#include <QString>
+#include <QHash>
+#include <QMutex>
+#include <kmimetype.h>
+#include "node/node_wrapper.h"
+
+namespace KIO_CLIPBOARD
+{
+  /*!
+   * class NodeClassifier
+   * @brief Decides upon the semantics of a clipboard entries payload.
+   * Classifying a payload used to be done by matching the "uri" and "path" patterns of the regex catalog.
+   * Those are backtracking patterns that take ages on long, slash-heavy texts.
+   * Instead the classifier scans a payload exactly once, running a small state machine for each pattern in parallel.
+   * The scan stops as soon as the payload cannot be an uri or a path any more, which is typically after a few characters.
+   * Mimetype detection only inspects a bounded prefix of a payload, the magic rules never look further anyway.
+   * Whether a mimetype counts as "code" is decided once per mimetype and remembered.
+   * There is exactly one classifier per process, it is created lazily on first usage, the construction is thread-safe.
+   * @see regExPool
+   * @see NodeWrapper::classify
+   * @author Christian Reiner
+   */
+  class NodeClassifier
+  {
+    private:
+      /*!
+       * UriState
+       * @brief States of the automaton equivalent to the "uri" pattern, each one is a bit in a state set.
+       */
+      enum UriState { U_PROTOCOL0, U_PROTOCOL1, U_PROTOCOL2, U_PROTOCOL3, U_PROTOCOL4,
+                      U_PROTOCOL5, U_PROTOCOL6, U_PROTOCOL7, U_PROTOCOL8, U_PROTOCOL9,
+                      U_COLON, U_SLASH1, U_SLASH2, U_SLASH3, U_USER, U_USER_DONE,
+                      U_DOMAIN_BLOCK, U_DOMAIN_SEPARATOR,
+                      U_TLD1, U_TLD2, U_TLD3, U_TLD4, U_TLD5, U_TLD6,
+                      U_PORT0, U_PORT,
+                      U_PATH_SLASH, U_PATH_SEGMENT, U_PATH_TRAIL,
+                      U_QUERY1, U_QUERY2, U_QUERY3, U_QUERY_DONE,
+                      U_ANCHOR0, U_ANCHOR };
+      /*!
+       * PathState
+       * @brief States of the automaton equivalent to the "path" pattern, this one is deterministic.
+       */
+      enum PathState { P_START, P_SLASH, P_SEGMENT, P_TRAIL, P_FAILED };
+      static quint64   stepUri  ( quint64 states, const QChar& c );
+      static PathState stepPath ( PathState state, const QChar& c );
+      mutable QMutex              m_mutex;
+      mutable QHash<QString,bool> m_code;
+    public:
+      static const NodeClassifier& instance ( );
+      NodeClassifier ( );
+      NodeWrapper::Semantics semantics ( const QString& trimmed ) const;
+      KMimeType::Ptr         mimetype  ( const QString& payload, int sniffLength ) const;
+      bool                   isCode    ( const KMimeType::Ptr& mimetype ) const;
+  }; // class NodeClassifier
+
+} // namespace KIO_CLIPBOARD
+
+#endif // NODE_CLASSIFIER_H
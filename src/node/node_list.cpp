@@ -13,31 +13,119 @@
  */
 
 #include <QVariant>
+#include <QDataStream>
 #include <qjson/parser.h>
 #include <qjson/serializer.h>
 #include <kdebug.h>
 #include "utility/exception.h"
 #include "node/node_wrapper.h"
 #include "node/node_list.h"
+#include "utility/trace.h"
 
 using namespace KIO;
 using namespace KIO_CLIPBOARD;
 
+// leading magic and current version of the binary snapshot notation
+static const quint32 C_snapshotMagic   = 0x4b434e4c; // "KCNL"
+static const quint16 C_snapshotVersion = 1;
+
+/*!
+ * NodeList::append
+ * @brief Appends a node to the end of the list, that is as the oldest entry.
+ * @param name name of the node, the hash of its payload
+ * @param node node to be appended
+ * @return false if the list already holds a node of that name, the node is not appended then
+ * @author Christian Reiner
+ */
+bool NodeList::append ( const QString& name, const NodeWrapper* node )
+{
+  if ( m_names.contains(name) )
+    return FALSE;
+  m_names.insert ( name, node );
+  m_positions.append ( node );
+  return TRUE;
+} // NodeList::append
+
 /*!
  * NodeList::toUDSEntryList
  * @brief Creates a UDSEntryList to describe all nodes contained in the list.
- * @return UDSEntryList
+ * @return UDSEntryList, in history order
  * @author Christian Reiner
  */
 UDSEntryList NodeList::toUDSEntryList ( ) const
 {
   UDSEntryList _entries;
-  foreach ( const NodeWrapper* const& _node, m_nodes )
+  foreach ( const NodeWrapper* const& _node, m_positions )
     _entries << _node->toUDSEntry();
-  kDebug() << "created list holding" << _entries.size() << "nodes";
+  kTrace(T_LIST) << "created list holding" << _entries.size() << "nodes";
   return _entries;
 } // NodeList::toUDSEntry
 
+/*!
+ * NodeList::toSnapshot
+ * @brief Serializes a list of nodes into a compact binary snapshot
+ * @return QByteArray holding the snapshot
+ * Layout: magic, version, number of nodes, then one fixed order record per node in history order.
+ * The records carry no field names, see NodeWrapper::toSnapshot for their layout.
+ * @see NodeList::fromSnapshot
+ * @author Christian Reiner
+ */
+QByteArray NodeList::toSnapshot ( ) const
+{
+  QByteArray _data;
+  QDataStream _stream ( &_data, QIODevice::WriteOnly );
+  _stream.setVersion ( QDataStream::Qt_4_6 );
+  _stream << C_snapshotMagic << C_snapshotVersion << quint32(m_positions.size());
+  foreach ( const NodeWrapper* const& _node, m_positions )
+    _node->toSnapshot ( _stream );
+  kTrace(T_LIST) << "created snapshot of" << m_positions.size() << "nodes," << _data.size() << "bytes";
+  return _data;
+} // NodeList::toSnapshot
+
+/*!
+ * NodeList::fromSnapshot
+ * @brief Constructs a list of nodes from a binary snapshot
+ * @param data snapshot as created by NodeList::toSnapshot
+ * @return list of node objects
+ * Data not starting with the snapshot magic is handed over to the JSON reader, this accepts the older notation.
+ * @see NodeList::toSnapshot
+ * @author Christian Reiner
+ */
+NodeList& NodeList::fromSnapshot ( const QByteArray& data )
+{
+  QDataStream _stream ( data );
+  _stream.setVersion ( QDataStream::Qt_4_6 );
+  quint32 _magic, _count;
+  quint16 _version;
+  _stream >> _magic;
+  if ( C_snapshotMagic!=_magic )
+    return fromJSON ( data );
+  _stream >> _version >> _count;
+  if ( QDataStream::Ok!=_stream.status() )
+    throw Exception ( Error(ERR_INTERNAL), "Failed to read header of node list snapshot" );
+  if ( C_snapshotVersion!=_version )
+    throw Exception ( Error(ERR_INTERNAL), QString("Unsupported version %1 of node list snapshot").arg(_version) );
+  clear ( );
+  // do not trust the count for preallocation beyond what the data can possibly hold
+  reserve ( qMin(_count,quint32(data.size())) );
+  for ( quint32 _position=0; _position<_count; _position++ )
+  {
+    NodeWrapper* _node = new NodeWrapper;
+    if ( ! _node->fromSnapshot(_stream) )
+    {
+      delete _node;
+      foreach ( const NodeWrapper* _node, m_positions )
+        delete _node;
+      clear ( );
+      throw Exception ( Error(ERR_INTERNAL), QString("Failed to read node %1 of node list snapshot").arg(_position) );
+    }
+    if ( ! append(_node->name(),_node) )
+      delete _node;
+  }
+  kTrace(T_LIST) << "created node list holding" << m_positions.size() << "entries from snapshot";
+  return *this;
+} // NodeList::fromSnapshot
+
 /*!
  * NodeList::toJSON
  * @brief Serializes a list of nodes to JSON data
@@ -46,13 +134,14 @@ UDSEntryList NodeList::toUDSEntryList ( ) const
  */
 QByteArray NodeList::toJSON ( ) const
 {
-  kDebug() << "creating JSON notation of node list holding" << m_nodes.size() << "entries";
-  // FIXME: guess this wont work since the map holds only pointers, not objects as values
-  QVariantMap _nodes;
-  NodeList::const_iterator _iterator;
-  for ( _iterator=m_nodes.begin(); _iterator!=m_nodes.end(); _iterator++ )
-    _nodes.insert ( _iterator.key(), _iterator.value()->toJSON() );
+  kTrace(T_LIST) << "creating JSON notation of node list holding" << m_positions.size() << "entries";
+  // each node is embedded as a JSON object, not as the string of its own notation:
+  // a string would be converted to latin1 on its way back and mangle titles holding other characters
+  QJson::Parser     _parser;
   QJson::Serializer _serializer;
+  QVariantMap       _nodes;
+  foreach ( const NodeWrapper* const& _node, m_positions )
+    _nodes.insert ( _node->name(), _parser.parse(_node->toJSON()) );
   return _serializer.serialize ( _nodes );
 } // NodeList::toJSON
 
@@ -65,17 +154,29 @@ QByteArray NodeList::toJSON ( ) const
  */
 NodeList& NodeList::fromJSON ( const QByteArray& json )
 {
-  kDebug();
+  kTrace(T_LIST);
   QJson::Parser parser;
   bool ok;
   QVariantMap _nodes = parser.parse ( json, &ok ).toMap();
   if ( ! ok )
     throw Exception ( Error(ERR_INTERNAL), "Failed to deserialize json notation of node list" );
-  // create nodes one by one and push them into the cleared list
-  m_nodes.clear ( );
+  // create nodes one by one, the notation is keyed by name, so the history order has to be restored afterwards
+  QMap<int, const NodeWrapper*> _positions;
   QVariantMap::iterator _iterator;
+  QJson::Serializer _serializer;
   for ( _iterator=_nodes.begin(); _iterator!=_nodes.end(); _iterator++ )
-    m_nodes.insert ( _iterator.key(), new NodeWrapper(_iterator.value().toByteArray()) );
-  kDebug() << "created node list holding" << m_nodes.size() << "entries from JSON notation";
+  {
+    // older notations embedded each node as a string holding its own JSON notation
+    const NodeWrapper* _node = new NodeWrapper ( QVariant::Map==_iterator.value().type()
+                                                 ? _serializer.serialize(_iterator.value())
+                                                 : _iterator.value().toString().toUtf8() );
+    _positions.insertMulti ( _node->index(), _node );
+  }
+  clear ( );
+  reserve ( _positions.size() );
+  foreach ( const NodeWrapper* _node, _positions )
+    if ( ! append(_node->name(),_node) )
+      delete _node;
+  kTrace(T_LIST) << "created node list holding" << m_positions.size() << "entries from JSON notation";
   return *this;
 } // NodeList::fromJSON
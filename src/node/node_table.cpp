@@ -0,0 +1,238 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Implementation of class NodeTable
+ * @see NodeTable
+ * @author Christian Reiner
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <klockfile.h>
+#include <kdebug.h>
+#include "node/node_table.h"
+#include "utility/trace.h"
+
+using namespace KIO_CLIPBOARD;
+
+// leading magic and current version of the table file
+static const char    C_tableMagic[4] = { 'K', 'C', 'N', 'T' };
+static const quint32 C_tableVersion  = 1;
+// length of node names as stored in the records, that is the length of a payload hash in hex notation
+static const int     C_tableNameLength = 32;
+// maximum number of classifications kept, beyond that the table is started over with the current ones
+static const int     C_tableCapacity   = 50000;
+
+/*!
+ * NodeTable::NodeTable
+ * @brief Constructor of class NodeTable
+ * @param path location of the table file
+ * The table is not mapped before attach() is called.
+ * @author Christian Reiner
+ */
+NodeTable::NodeTable ( const QString& path )
+  : m_path  ( path )
+  , m_file  ( path )
+  , m_data  ( 0 )
+  , m_size  ( 0 )
+  , m_count ( 0 )
+{
+  kTrace(T_CACHE) << path;
+} // NodeTable::NodeTable
+
+/*!
+ * NodeTable::~NodeTable
+ * @brief Destructor of class NodeTable
+ * @author Christian Reiner
+ */
+NodeTable::~NodeTable ( )
+{
+  kTrace(T_CACHE);
+  detach ( );
+} // NodeTable::~NodeTable
+
+/*!
+ * NodeTable::detach
+ * @brief Releases the mapping of the table file.
+ * Classifications handed out by find() before are invalid afterwards.
+ * @author Christian Reiner
+ */
+void NodeTable::detach ( )
+{
+  if ( m_data )
+    m_file.unmap ( const_cast<uchar*>(m_data) );
+  m_file.close ( );
+  m_data  = 0;
+  m_size  = 0;
+  m_count = 0;
+} // NodeTable::detach
+
+/*!
+ * NodeTable::attach
+ * @brief Maps the current version of the table file into memory.
+ * @return true if a valid table is mapped now
+ * Since writers replace the file instead of changing it this always maps the latest table written.
+ * Classifications handed out by find() before are invalid afterwards.
+ * @author Christian Reiner
+ */
+bool NodeTable::attach ( )
+{
+  detach ( );
+  if ( ! m_file.open(QIODevice::ReadOnly) )
+    return FALSE;
+  m_size = m_file.size ( );
+  if ( m_size<qint64(sizeof(Header)) || 0==(m_data=m_file.map(0,m_size)) )
+  {
+    detach ( );
+    return FALSE;
+  }
+  const Header* _header = reinterpret_cast<const Header*> ( m_data );
+  if (    0!=memcmp(_header->magic,C_tableMagic,sizeof(C_tableMagic))
+       || C_tableVersion!=_header->version
+       || qint64(sizeof(Header))+qint64(_header->count)*qint64(sizeof(Record))>m_size )
+  {
+    kTrace(T_CACHE) << "ignoring unusable table" << m_path;
+    detach ( );
+    return FALSE;
+  }
+  m_count = _header->count;
+  kTrace(T_CACHE) << "mapped table holding" << m_count << "classifications";
+  return TRUE;
+} // NodeTable::attach
+
+/*!
+ * NodeTable::find
+ * @brief Looks up the classification of a node in the mapped table.
+ * @param name name of the node, this is the hash of its payload
+ * @param data reference that receives the serialized classification
+ * @return true if the table holds a classification for that node
+ * The data refers to the mapped file directly, it is valid until the table is attached again or destroyed.
+ * @author Christian Reiner
+ */
+bool NodeTable::find ( const QString& name, QByteArray& data ) const
+{
+  if ( 0==m_count || C_tableNameLength!=name.length() )
+    return FALSE;
+  const QByteArray _name    = name.toLatin1 ( );
+  const Record*    _records = reinterpret_cast<const Record*> ( m_data+sizeof(Header) );
+  quint32 _lower = 0;
+  quint32 _upper = m_count;
+  while ( _lower<_upper )
+  {
+    const quint32 _middle  = _lower + (_upper-_lower)/2;
+    const int     _compare = memcmp ( _name.constData(), _records[_middle].name, C_tableNameLength );
+    if ( 0<_compare )
+      _lower = _middle+1;
+    else if ( 0>_compare )
+      _upper = _middle;
+    else
+    {
+      const Record& _record = _records[_middle];
+      if ( qint64(_record.offset)+qint64(_record.length)>m_size )
+        return FALSE;
+      data = QByteArray::fromRawData ( reinterpret_cast<const char*>(m_data+_record.offset), _record.length );
+      return TRUE;
+    }
+  }
+  return FALSE;
+} // NodeTable::find
+
+/*!
+ * NodeTable::collect
+ * @brief Copies all classifications of the mapped table into a map.
+ * @param classifications map the classifications are added to, keyed by node name
+ * @author Christian Reiner
+ */
+void NodeTable::collect ( QMap<QString,QByteArray>& classifications ) const
+{
+  const Record* _records = reinterpret_cast<const Record*> ( m_data+sizeof(Header) );
+  for ( quint32 _position=0; _position<m_count; _position++ )
+  {
+    const Record& _record = _records[_position];
+    if ( qint64(_record.offset)+qint64(_record.length)>m_size )
+      continue;
+    classifications.insert ( QString::fromLatin1(_record.name,C_tableNameLength),
+                             QByteArray(reinterpret_cast<const char*>(m_data+_record.offset),_record.length) );
+  }
+} // NodeTable::collect
+
+/*!
+ * NodeTable::write
+ * @brief Adds classifications to the table file.
+ * @param classifications serialized classifications keyed by node name
+ * @return true if the table file has been replaced
+ * Writers take turns by means of a lock file. Each one merges its classifications with the table written last,
+ * so nothing another slave has published gets lost. The table is started over once it grows beyond its capacity.
+ * The file is written aside and renamed into place, so readers never see a partial table.
+ * It is not synced to disk, the table is of no use after a crash of the system anyway.
+ * The merged table is mapped afterwards, so classifications handed out by find() before are invalid.
+ * @author Christian Reiner
+ */
+bool NodeTable::write ( const QMap<QString,QByteArray>& classifications )
+{
+  KLockFile _lock ( m_path+".lock" );
+  if ( KLockFile::LockOK!=_lock.lock() )
+  {
+    kTrace(T_CACHE) << "failed to lock table" << m_path;
+    return FALSE;
+  }
+  // merge with the latest table, whoever wrote that
+  QMap<QString,QByteArray> _merged;
+  if ( attach() && m_count+classifications.size()<=quint32(C_tableCapacity) )
+    collect ( _merged );
+  QMap<QString,QByteArray>::const_iterator _iterator;
+  for ( _iterator=classifications.constBegin(); _iterator!=classifications.constEnd(); ++_iterator )
+    _merged.insert ( _iterator.key(), _iterator.value() );
+  // the map is sorted by name already, which is the order the records have to be in
+  QByteArray _records;
+  QByteArray _area;
+  const quint32 _base = sizeof(Header) + _merged.size()*sizeof(Record);
+  for ( _iterator=_merged.constBegin(); _iterator!=_merged.constEnd(); ++_iterator )
+  {
+    const QByteArray _name = _iterator.key().toLatin1 ( );
+    if ( C_tableNameLength!=_name.length() )
+      continue;
+    Record _record;
+    memcpy ( _record.name, _name.constData(), C_tableNameLength );
+    _record.offset = _base + _area.size();
+    _record.length = _iterator.value().size();
+    _records.append ( reinterpret_cast<const char*>(&_record), sizeof(Record) );
+    _area.append ( _iterator.value() );
+  }
+  Header _header;
+  memcpy ( _header.magic, C_tableMagic, sizeof(C_tableMagic) );
+  _header.version  = C_tableVersion;
+  _header.count    = _records.size() / sizeof(Record);
+  _header.reserved = 0;
+  // names of unexpected length have been skipped, so the data area might have to be moved
+  if ( _header.count!=quint32(_merged.size()) )
+  {
+    const quint32 _shift = (_merged.size()-_header.count) * sizeof(Record);
+    Record* _record = reinterpret_cast<Record*> ( _records.data() );
+    for ( quint32 _position=0; _position<_header.count; _position++ )
+      _record[_position].offset -= _shift;
+  }
+  QFile _file ( QString("%1.%2").arg(m_path).arg(::getpid()) );
+  bool _written =    _file.open(QIODevice::WriteOnly|QIODevice::Truncate)
+                  && qint64(sizeof(Header))==_file.write(reinterpret_cast<const char*>(&_header),sizeof(Header))
+                  && _records.size()==_file.write(_records)
+                  && _area.size()==_file.write(_area);
+  _file.close ( );
+  // QFile::rename() refuses to replace an existing file
+  if ( ! _written || 0!=::rename(QFile::encodeName(_file.fileName()),QFile::encodeName(m_path)) )
+  {
+    kTrace(T_CACHE) << "failed to write table" << m_path << _file.errorString();
+    _file.remove ( );
+    return FALSE;
+  }
+  kTrace(T_CACHE) << "wrote table holding" << _header.count << "classifications," << sizeof(Header)+_records.size()+_area.size() << "bytes";
+  attach ( );
+  return TRUE;
+} // NodeTable::write
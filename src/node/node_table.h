@@ -0,0 +1,85 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Declaration of class NodeTable
+ * @see NodeTable
+ * @author Christian Reiner
+ */
+
+#ifndef NODE_TABLE_H
+#define NODE_TABLE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QMap>
+#include <QFile>
+
+namespace KIO_CLIPBOARD
+{
+  /*!
+   * class NodeTable
+   * @brief Read-only table of node classifications, memory mapped from a file shared by all slave processes.
+   * A fresh slave would have to classify every entry of a history, unless another slave has done so before.
+   * The table offers what has been classified so far without parsing anything:
+   * the file is mapped into memory and consists of a header, fixed size records sorted by node name
+   * and a data area holding the serialized classifications the records point to.
+   * Looking up a node is a binary search over the records, the classification is returned without copying it.
+   * The table is never modified in place, a writer replaces the whole file atomically.
+   * Writers take turns by means of a lock file and merge what they have to add with the table written last,
+   * so the classifications of all slaves are collected. Slaves still mapping an old file keep on reading that until they attach again.
+   * Nothing is synced to disk: the table lives in the temporary folder and is only an accelerator,
+   * a damaged or missing table just means classifying again.
+   * @see NodeWrapper::toClassification
+   * @author Christian Reiner
+   */
+  class NodeTable
+  {
+    private:
+      /*!
+       * Header
+       * @brief Leading block of the table file.
+       */
+      struct Header
+      {
+        char    magic[4];
+        quint32 version;
+        quint32 count;
+        quint32 reserved;
+      };
+      /*!
+       * Record
+       * @brief Fixed size entry of the table, one per node, pointing into the data area.
+       */
+      struct Record
+      {
+        char    name[32];
+        quint32 offset;
+        quint32 length;
+      };
+      const QString m_path;
+      QFile         m_file;
+      const uchar*  m_data;
+      qint64        m_size;
+      quint32       m_count;
+      void detach ( );
+      void collect ( QMap<QString,QByteArray>& classifications ) const;
+    public:
+      NodeTable ( const QString& path );
+      ~NodeTable ( );
+      inline const QString& path    ( ) const { return m_path;   };
+      inline int            count   ( ) const { return m_count;  };
+      inline bool           isEmpty ( ) const { return 0==m_count; };
+      bool attach ( );
+      bool find   ( const QString& name, QByteArray& data ) const;
+      bool write  ( const QMap<QString,QByteArray>& classifications );
+  }; // class NodeTable
+
+} // namespace KIO_CLIPBOARD
+
+#endif // NODE_TABLE_H
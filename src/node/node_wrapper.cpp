@@ -13,7 +13,7 @@
  */
 
 #include <QObject>
-#include <QCryptographicHash>
+#include <QDataStream>
 #include <QVariant>
 #include <qjson/parser.h>
 #include <qjson/serializer.h>
@@ -27,6 +27,9 @@
 #include "utility/exception.h"
 #include "protocol/kio_clipboard_protocol.h"
 #include "node/node_wrapper.h"
+#include "node/node_classifier.h"
+#include "utility/trace.h"
+#include "utility/instrumentation.h"
 
 using namespace KIO;
 using namespace KIO_CLIPBOARD;
@@ -47,51 +50,95 @@ using namespace KIO_CLIPBOARD;
  */
 NodeWrapper::NodeWrapper ( ClipboardFrontend* const clipboard,  int index, const QString& payload, QObject* parent )
   : QObject ( parent )
+  , m_classified ( FALSE )
+  , m_payload    ( payload )
+  , m_clipboard  ( clipboard )
+  , m_udsEntryValid ( FALSE )
   , m_mappingNameCardinality ( clipboard->mappingNameCardinality() )
   , m_mappingNameLength      ( clipboard->mappingNameLength() )
   , m_mappingNamePattern     ( clipboard->mappingNamePattern() )
 {
-  kDebug() << index;
-  QString _trimmed = payload.trimmed ( );
+  kTrace(T_NODE) << index;
   m_index = index;
   m_size  = payload.size();
-  // we do NOT request any datetime from files or URLs, so we can just set it plain here
-  // reason is that usually we read the value from a history, except when we first access the object
-  m_datetime = KDateTime::currentLocalDateTime();
   // fixed access rights currently, entries of local clipboards should only be accessible from inside the session itself
   m_access = 0400;
   // construct a valid file name, even for a payload that is a path or url
-  m_name  = payload2name ( payload );
+  m_name  = payload2name ( payload, clipboard->mappingNameHash() );
   // mark first entry in the list as the newest by using an overlay
-  if ( 1==index )
-    m_overlays << "emblem-new";
-  // decide about the sematics ("meaning") of the content
-  if ( _trimmed.isEmpty() )
-  {
-    m_semantics = KIO_CLIPBOARD::NodeWrapper::S_EMPTY;
-    m_title     = "";
-  }
-  else if ( m_regEx["uri"].exactMatch(_trimmed) )
-  {
-    m_semantics = KIO_CLIPBOARD::NodeWrapper::S_URL;
-    m_title     = payload2title ( payload );
-    m_url       = KUrl ( _trimmed );
-    m_link      = KUrl ( _trimmed );
-    if ( m_url.isLocalFile() )
-      m_path      = m_url.path ( );
-  }
-  else if ( m_regEx["path"].exactMatch(_trimmed) )
+  setPosition ( index, m_mappingNameCardinality );
+  // everything else depends on the payload and is worked out when first required, see ensureClassified()
+} // NodeWrapper::NodeWrapper
+
+/*!
+ * NodeWrapper::ensureClassified
+ * @brief Works out all attributes that depend on the payload, if that has not been done before.
+ * Classifying an entry is expensive (pattern matching, mimetype detection), whilst a listing mostly needs name, size and type.
+ * So nodes are constructed with the cheap attributes only, this is called by all accessors of the remaining ones.
+ * The result is memorized, the payload itself is released afterwards.
+ * Logically the node stays constant, that is why this can be called from const methods.
+ * @author Christian Reiner
+ */
+void NodeWrapper::ensureClassified ( ) const
+{
+  if ( m_classified )
+    return;
+  NodeWrapper* const _this = const_cast<NodeWrapper*> ( this );
+  _this->m_classified = TRUE;
+  // we do NOT request any datetime from files or URLs, so we can just set it plain here
+  // reason is that usually we read the value from a history, except when we first access the object
+  _this->m_datetime = KDateTime::currentLocalDateTime();
+  // classification is expensive, so we try to reuse a result another slave process has already stored
+  QByteArray _classification;
+  if ( ! ( m_clipboard->findClassification(m_name,_classification) && _this->fromClassification(_classification) ) )
   {
-    m_semantics = KIO_CLIPBOARD::NodeWrapper::S_FILE;
-    m_title     = payload2title ( payload );
-    m_url       = KUrl ( _trimmed );
-    m_link      = KUrl ( _trimmed );
-    m_path      = _trimmed;
+    _this->classify ( m_payload, m_clipboard->mimetypeSniffLength() );
+    m_clipboard->insertClassification ( m_name, toClassification() );
   }
-  else
+  // classification resets the overlays, so restore the positional one
+  _this->setPosition ( m_index, m_mappingNameCardinality );
+  _this->m_payload = QString ( );
+} // NodeWrapper::ensureClassified
+
+/*!
+ * NodeWrapper::classify
+ * @brief Decides upon the semantics ("meaning") of a payload and all attributes depending on it.
+ * @param payload content of the item
+ * @param sniffLength number of leading characters of the payload inspected for mimetype detection
+ * Primitive rules are used decide upon a few basic interpretations of the type of content in an entry.
+ * The result depends on the payload only, so it can be shared between processes by means of a cache.
+ * @see NodeWrapper::toClassification
+ * @author Christian Reiner
+ */
+void NodeWrapper::classify ( const QString& payload, int sniffLength )
+{
+  kTrace(T_NODE) << m_name;
+  InstrumentationTimer _timer ( "node.classify" );
+  invalidateUDSEntry ( );
+  QString _trimmed = payload.trimmed ( );
+  m_overlays.clear ( );
+  // decide about the sematics ("meaning") of the content
+  m_semantics = NodeClassifier::instance().semantics ( _trimmed );
+  switch ( m_semantics )
   {
-    m_semantics = KIO_CLIPBOARD::NodeWrapper::S_TEXT;
-    m_title     = payload2title ( payload );
+    case KIO_CLIPBOARD::NodeWrapper::S_EMPTY:
+      m_title     = "";
+      break;
+    case KIO_CLIPBOARD::NodeWrapper::S_URL:
+      m_title     = payload2title ( payload );
+      m_url       = KUrl ( _trimmed );
+      m_link      = KUrl ( _trimmed );
+      if ( m_url.isLocalFile() )
+        m_path      = m_url.path ( );
+      break;
+    case KIO_CLIPBOARD::NodeWrapper::S_FILE:
+      m_title     = payload2title ( payload );
+      m_url       = KUrl ( _trimmed );
+      m_link      = KUrl ( _trimmed );
+      m_path      = _trimmed;
+      break;
+    default:
+      m_title     = payload2title ( payload );
   }
   switch ( m_semantics )
   {
@@ -102,19 +149,14 @@ NodeWrapper::NodeWrapper ( ClipboardFrontend* const clipboard,  int index, const
       break;
     case KIO_CLIPBOARD::NodeWrapper::S_TEXT:
       m_type     = S_IFREG;
-      m_mimetype = KMimeType::findByContent(payload.toUtf8());
+      m_mimetype = NodeClassifier::instance().mimetype ( payload, sniffLength );
       // check if we can refine the sematics to something more specific
-      // TODO: find some more generic way as an alternative to this list of test for recognized mimetypes
-      if (  ("text/x-"==m_mimetype->name().left(7))
-          ||(m_mimetype->is("text/css"))
-          ||(m_mimetype->is("text/html"))
-          ||(m_mimetype->is("text/sgml"))
-          ||(m_mimetype->is("text/xml")) )
+      if ( NodeClassifier::instance().isCode(m_mimetype) )
         m_semantics = KIO_CLIPBOARD::NodeWrapper::S_CODE;
       break;
     case KIO_CLIPBOARD::NodeWrapper::S_CODE:
       m_type     = S_IFREG;
-      m_mimetype = KMimeType::findByContent(payload.toUtf8());
+      m_mimetype = NodeClassifier::instance().mimetype ( payload, sniffLength );
       break;
     case KIO_CLIPBOARD::NodeWrapper::S_FILE:
 //      m_type     = S_IFREG;
@@ -143,7 +185,143 @@ NodeWrapper::NodeWrapper ( ClipboardFrontend* const clipboard,  int index, const
       m_type     = S_IFMT;
       m_mimetype = KMimeType::mimeType("application/octet-stream");
   }
-} // NodeWrapper::NodeWrapper
+} // NodeWrapper::classify
+
+/*!
+ * NodeWrapper::writeClassification
+ * @brief Writes those attributes of a node that depend on the payload alone into a stream.
+ * @param stream binary stream to write to
+ * Positional attributes are left out, that is why the "new" emblem is not written.
+ * @see NodeWrapper::readClassification
+ * @author Christian Reiner
+ */
+void NodeWrapper::writeClassification ( QDataStream& stream ) const
+{
+  QStringList _overlays = m_overlays;
+  _overlays.removeAll ( "emblem-new" );
+  stream << qint32(m_semantics)
+         << m_mimetype->name()
+         << m_title
+         << qint32(m_type)
+         << _overlays
+         << m_url.url()
+         << m_link.url()
+         << m_path
+         << m_icon;
+} // NodeWrapper::writeClassification
+
+/*!
+ * NodeWrapper::readClassification
+ * @brief Reads those attributes of a node that depend on the payload alone from a stream.
+ * @param stream binary stream to read from
+ * @return true if the attributes could be read, false if the stream is exhausted or corrupt
+ * @see NodeWrapper::writeClassification
+ * @author Christian Reiner
+ */
+bool NodeWrapper::readClassification ( QDataStream& stream )
+{
+  qint32 _semantics, _type;
+  QString _mimetype, _url, _link;
+  invalidateUDSEntry ( );
+  stream >> _semantics >> _mimetype >> m_title >> _type >> m_overlays >> _url >> _link >> m_path >> m_icon;
+  if ( QDataStream::Ok!=stream.status() )
+    return FALSE;
+  m_semantics = Semantics ( _semantics );
+  m_type      = _type;
+  m_mimetype  = KMimeType::mimeType ( _mimetype );
+  if ( m_mimetype.isNull() )
+    m_mimetype = KMimeType::defaultMimeTypePtr ( );
+  m_url       = _url.isEmpty()  ? KUrl() : KUrl ( _url );
+  m_link      = _link.isEmpty() ? KUrl() : KUrl ( _link );
+  return TRUE;
+} // NodeWrapper::readClassification
+
+/*!
+ * NodeWrapper::toClassification
+ * @brief Serializes the result of a classification into a compact binary notation.
+ * @return QByteArray holding the serialized classification
+ * Only those attributes are stored that depend on the payload alone, positional attributes are left out.
+ * @see NodeWrapper::fromClassification
+ * @author Christian Reiner
+ */
+QByteArray NodeWrapper::toClassification ( ) const
+{
+  ensureClassified ( );
+  QByteArray _data;
+  QDataStream _stream ( &_data, QIODevice::WriteOnly );
+  _stream.setVersion ( QDataStream::Qt_4_6 );
+  _stream << quint8(1);
+  writeClassification ( _stream );
+  return _data;
+} // NodeWrapper::toClassification
+
+/*!
+ * NodeWrapper::fromClassification
+ * @brief Restores the result of a classification from its binary notation.
+ * @param data serialized classification as created by NodeWrapper::toClassification
+ * @return true if the data could be restored, false if it is unusable (for example of an outdated format)
+ * @see NodeWrapper::toClassification
+ * @author Christian Reiner
+ */
+bool NodeWrapper::fromClassification ( const QByteArray& data )
+{
+  QDataStream _stream ( data );
+  _stream.setVersion ( QDataStream::Qt_4_6 );
+  quint8 _version;
+  _stream >> _version;
+  if ( 1!=_version )
+    return FALSE;
+  return readClassification ( _stream );
+} // NodeWrapper::fromClassification
+
+/*!
+ * NodeWrapper::toSnapshot
+ * @brief Writes the complete node as one fixed order binary record into a stream.
+ * @param stream binary stream to write to, its version is set by the caller
+ * The record holds no field names, the field order is defined by this method alone.
+ * Any change in order or content requires a new snapshot version in NodeList::toSnapshot.
+ * @see NodeWrapper::fromSnapshot
+ * @author Christian Reiner
+ */
+void NodeWrapper::toSnapshot ( QDataStream& stream ) const
+{
+  ensureClassified ( );
+  stream << qint32(m_index)
+         << qint32(m_size)
+         << qint32(m_access)
+         << m_name
+         << m_datetime
+         << qint32(m_mappingNameCardinality)
+         << qint32(m_mappingNameLength)
+         << m_mappingNamePattern;
+  writeClassification ( stream );
+} // NodeWrapper::toSnapshot
+
+/*!
+ * NodeWrapper::fromSnapshot
+ * @brief Reads a complete node from a binary record as written by NodeWrapper::toSnapshot.
+ * @param stream binary stream to read from
+ * @return true if the record could be read, false if the stream is exhausted or corrupt
+ * @see NodeWrapper::toSnapshot
+ * @author Christian Reiner
+ */
+bool NodeWrapper::fromSnapshot ( QDataStream& stream )
+{
+  qint32 _index, _size, _access, _cardinality, _length;
+  stream >> _index >> _size >> _access >> m_name >> m_datetime >> _cardinality >> _length >> m_mappingNamePattern;
+  if ( QDataStream::Ok!=stream.status() || ! readClassification(stream) )
+    return FALSE;
+  m_index                  = _index;
+  m_size                   = _size;
+  m_access                 = _access;
+  m_mappingNameCardinality = _cardinality;
+  m_mappingNameLength      = _length;
+  m_classified             = TRUE;
+  m_payload                = QString ( );
+  // the "new" emblem is a positional attribute, so it is not part of the record
+  setPosition ( m_index, m_mappingNameCardinality );
+  return TRUE;
+} // NodeWrapper::fromSnapshot
 
 /*!
  * NodeWrapper::NodeWrapper
@@ -155,8 +333,11 @@ NodeWrapper::NodeWrapper ( ClipboardFrontend* const clipboard,  int index, const
  */
 NodeWrapper::NodeWrapper ( const QByteArray& json, QObject* parent )
   : QObject ( parent )
+  , m_classified ( TRUE )
+  , m_clipboard  ( 0 )
+  , m_udsEntryValid ( FALSE )
 {
-  kDebug();
+  kTrace(T_NODE);
   fromJSON ( json );
 } // NodeWrapper::toJSON
 
@@ -170,11 +351,17 @@ NodeWrapper::NodeWrapper ( const QByteArray& json, QObject* parent )
  */
 NodeWrapper::NodeWrapper ( const NodeWrapper& node, QObject* parent )
   : QObject ( parent )
+  , m_udsEntryValid ( FALSE )
 {
-  kDebug();
+  kTrace(T_NODE);
+  m_classified             = node.m_classified;
+  m_payload                = node.m_payload;
+  m_clipboard              = node.m_clipboard;
   m_index                  = node.m_index;
   m_title                  = node.m_title;
   m_size                   = node.m_size;
+  m_datetime               = node.m_datetime;
+  m_access                 = node.m_access;
   m_mimetype               = node.m_mimetype;
   m_semantics              = node.m_semantics;
   m_name                   = node.m_name;
@@ -198,8 +385,11 @@ NodeWrapper::NodeWrapper ( const NodeWrapper& node, QObject* parent )
  */
 NodeWrapper::NodeWrapper ( QObject* parent )
   : QObject ( parent )
+  , m_classified ( TRUE )
+  , m_clipboard  ( 0 )
+  , m_udsEntryValid ( FALSE )
 {
-  kDebug();
+  kTrace(T_NODE);
 } // NodeWrapper::NodeWrapper
 
 /*!
@@ -210,9 +400,32 @@ NodeWrapper::NodeWrapper ( QObject* parent )
  */
 NodeWrapper::~NodeWrapper ( )
 {
-  kDebug();
+  kTrace(T_NODE);
 } // NodeWrapper::~NodeWrapper
 
+/*!
+ * NodeWrapper::setPosition
+ * @brief Moves a node to a new position inside the clipboard.
+ * @param index new numerical index of the item
+ * @param cardinality new cardinality of the numerical index as used in names
+ * The payload of an entry does not change when other entries are added or removed, only its position does.
+ * So instead of constructing a fresh node we only fix the position related attributes of an existing one.
+ * @author Christian Reiner
+ */
+void NodeWrapper::setPosition ( int index, int cardinality )
+{
+  kTrace(T_NODE) << m_index << "=>" << index;
+  // display name and overlays depend on the position, so the description has to be built again if that changes
+  if ( index!=m_index || cardinality!=m_mappingNameCardinality )
+    invalidateUDSEntry ( );
+  m_index                  = index;
+  m_mappingNameCardinality = cardinality;
+  // only the first entry in the list is marked as the newest
+  m_overlays.removeAll ( "emblem-new" );
+  if ( 1==index )
+    m_overlays.prepend ( "emblem-new" );
+} // NodeWrapper::setPosition
+
 //==========
 
 /*!
@@ -227,7 +440,7 @@ NodeWrapper::~NodeWrapper ( )
 QString NodeWrapper::prettyIndex ( ) const
 {
   QString _pretty = QString("%1").arg(m_index,m_mappingNameCardinality,10,QChar('0'));
-  kDebug() << _pretty;
+  kTrace(T_NODE) << _pretty;
   return _pretty;
 } // NodeWrapper::prettyIndex
 
@@ -239,7 +452,8 @@ QString NodeWrapper::prettyIndex ( ) const
  */
 QString NodeWrapper::prettyMimetype ( ) const
 {
-  kDebug() << m_mimetype->comment();
+  ensureClassified ( );
+  kTrace(T_NODE) << m_mimetype->comment();
   return m_mimetype->comment();
 } // NodeWrapper::prettyMimetype
 
@@ -253,6 +467,7 @@ QString NodeWrapper::prettyMimetype ( ) const
  */
 QString NodeWrapper::prettySemantics ( ) const
 {
+  ensureClassified ( );
   QString _pretty;
   switch ( m_semantics )
   {
@@ -265,7 +480,7 @@ QString NodeWrapper::prettySemantics ( ) const
     case KIO_CLIPBOARD::NodeWrapper::S_URL:   _pretty = i18n ( "URL" );       break;
     default:                     _pretty = i18n ( "???" );
   } // switch
-  kDebug() << _pretty;
+  kTrace(T_NODE) << _pretty;
   return _pretty;
 } // NodeWrapper::prettySemantics
 
@@ -281,6 +496,7 @@ QString NodeWrapper::prettySemantics ( ) const
  */
 QString NodeWrapper::prettyName ( ) const
 {
+  ensureClassified ( );
   // we construct something like this: "007(String): Es war einmal vor langer, langer Zeit [...]"
   QString _pretty = m_mappingNamePattern
                     // a leading numerical index, cardinality depends of the size of the set of nodes
@@ -289,7 +505,7 @@ QString NodeWrapper::prettyName ( ) const
                     .arg( prettySemantics() )
                     // the whole alpha-numerical content
                     .arg( m_title );
-  kDebug() << _pretty;
+  kTrace(T_NODE) << _pretty;
   return _pretty;
 } // NodeWrapper::prettyName
 
@@ -301,8 +517,9 @@ QString NodeWrapper::prettyName ( ) const
  */
 QString NodeWrapper::prettyUrl ( ) const
 {
+  ensureClassified ( );
   QString _pretty = m_url.prettyUrl();
-  kDebug() << _pretty;
+  kTrace(T_NODE) << _pretty;
   return _pretty;
 } // NodeWrapper::prettyUrl
 
@@ -314,8 +531,9 @@ QString NodeWrapper::prettyUrl ( ) const
  */
 QString NodeWrapper::prettyDatetime ( ) const
 {
+  ensureClassified ( );
   QString _pretty = KGlobal::locale()->formatDateTime ( m_datetime, KLocale::LongDate );
-  kDebug() << _pretty;
+  kTrace(T_NODE) << _pretty;
   return _pretty;
 } // NodeWrapper::prettyDatetime
 
@@ -336,20 +554,26 @@ QString NodeWrapper::payload2title ( const QString& payload )
   QString _title = payload.simplified();
   if ( m_mappingNameLength<_title.length() )
     _title = QString("%1[...]").arg(_title.left(m_mappingNameLength-5));
-  kDebug() << _title;
+  kTrace(T_NODE) << _title;
   return _title;
 } // NodeWrapper::payload2title
 
 /*!
  * NodeWrapper::payload2name
  * @brief Creates a unique identifier of the item
+ * @param payload payload of the item
+ * @param strategy hash strategy used to create the identifier
+ * @return string holding the identifier
  * This is required, since the position of the entry changes inside a clipboard.
  * This leads to outdated urls if we would use a descriptive string like in UDSEntry::DisplayName
+ * Identifiers end up in urls users keep, so by default they are md5 hashes, just like those of older versions.
+ * The environment variable KIO_CLIPBOARD_NAME_HASH=murmur3 chooses a much faster hash instead, which changes all identifiers.
+ * @see payloadHash
  * @author Christian Reiner
  */
-QString NodeWrapper::payload2name ( const QString& payload )
+QString NodeWrapper::payload2name ( const QString& payload, PayloadHash strategy )
 {
-  return QString ( QCryptographicHash::hash(payload.toUtf8(), QCryptographicHash::Md5).toHex() );
+  return payloadHash ( payload, strategy );
 } // NodeWrapper::payload2name
 
 /*!
@@ -358,54 +582,39 @@ QString NodeWrapper::payload2name ( const QString& payload )
  * @return UDSEntry describing the node item
  * However we have to translate such an object to present the entry to the outside world.
  * This is done by translating an object to a constant UDSEntry as understood by the underlying KIO system.
+ * The entry is built once and memorized, listings and stat requests following each other hand out the same entry.
+ * Moving the node to another position drops the memorized entry, since display name and overlays depend on that.
  * @author Christian Reiner
  */
 UDSEntry NodeWrapper::toUDSEntry ( ) const
 {
-  kDebug() << "[" << m_index << "]:" << prettyName();
-  UDSEntry _entry;
-  _entry.insert( UDSEntry::UDS_NAME,               m_name );
-  _entry.insert( UDSEntry::UDS_DISPLAY_NAME,       prettyName() );
-  _entry.insert( UDSEntry::UDS_FILE_TYPE,          m_type );
-  _entry.insert( UDSEntry::UDS_MIME_TYPE,          m_mimetype->name() );
-  _entry.insert( UDSEntry::UDS_DISPLAY_TYPE,       m_mimetype->comment() );
-  _entry.insert( UDSEntry::UDS_SIZE,               m_size );
-  _entry.insert( UDSEntry::UDS_ACCESS,             m_access );
-  _entry.insert( UDSEntry::UDS_MODIFICATION_TIME,  m_datetime.toTime_t() );
+  ensureClassified ( );
+  if ( m_udsEntryValid )
+    return m_udsEntry;
+  InstrumentationTimer _timer ( "node.udsentry" );
+  const QString _prettyName = prettyName ( );
+  kTrace(T_NODE) << "[" << m_index << "]:" << _prettyName;
+  m_udsEntry.clear ( );
+  m_udsEntry.insert( UDSEntry::UDS_NAME,               m_name );
+  m_udsEntry.insert( UDSEntry::UDS_DISPLAY_NAME,       _prettyName );
+  m_udsEntry.insert( UDSEntry::UDS_FILE_TYPE,          m_type );
+  m_udsEntry.insert( UDSEntry::UDS_MIME_TYPE,          m_mimetype->name() );
+  m_udsEntry.insert( UDSEntry::UDS_DISPLAY_TYPE,       m_mimetype->comment() );
+  m_udsEntry.insert( UDSEntry::UDS_SIZE,               m_size );
+  m_udsEntry.insert( UDSEntry::UDS_ACCESS,             m_access );
+  m_udsEntry.insert( UDSEntry::UDS_MODIFICATION_TIME,  m_datetime.toTime_t() );
   if ( !m_path.isEmpty() )
-    _entry.insert( UDSEntry::UDS_LOCAL_PATH,         m_path );
+    m_udsEntry.insert( UDSEntry::UDS_LOCAL_PATH,         m_path );
   if ( ! m_url.isEmpty() )
-    _entry.insert( UDSEntry::UDS_TARGET_URL,         m_url.url() );
+    m_udsEntry.insert( UDSEntry::UDS_TARGET_URL,         m_url.url() );
 //  if ( ! m_link.isEmpty() )
-//    _entry.insert( UDSEntry::UDS_LINK_DEST,          m_link.url() );
+//    m_udsEntry.insert( UDSEntry::UDS_LINK_DEST,          m_link.url() );
   if ( ! m_icon.isEmpty() )
-    _entry.insert( UDSEntry::UDS_ICON_NAME,          m_icon );
+    m_udsEntry.insert( UDSEntry::UDS_ICON_NAME,          m_icon );
   if ( ! m_overlays.isEmpty() )
-    _entry.insert( UDSEntry::UDS_ICON_OVERLAY_NAMES, m_overlays.join(",") );
-
-  // some intense debugging output...
-  QList<uint> _tags = _entry.listFields ( );
-  kDebug() << "list of defined UDS entry tags for entry" << prettyIndex() << ":";
-  foreach ( uint _tag, _tags )
-    switch ( _tag )
-    {
-      case UDSEntry::UDS_NAME:               kDebug() << "UDS_NAME:"               << _entry.stringValue(_tag); break;
-      case UDSEntry::UDS_DISPLAY_NAME:       kDebug() << "UDS_DISPLAY_NAME:"       << _entry.stringValue(_tag); break;
-      case UDSEntry::UDS_FILE_TYPE:          kDebug() << "UDS_FILE_TYPE:"          << _entry.numberValue(_tag); break;
-      case UDSEntry::UDS_MIME_TYPE:          kDebug() << "UDS_MIME_TYPE:"          << _entry.stringValue(_tag); break;
-      case UDSEntry::UDS_DISPLAY_TYPE:       kDebug() << "UDS_DISPLAY_TYPE:"       << _entry.stringValue(_tag); break;
-      case UDSEntry::UDS_LOCAL_PATH:         kDebug() << "UDS_LOCAL_PATH:"         << _entry.stringValue(_tag); break;
-      case UDSEntry::UDS_URL:                kDebug() << "UDS_URL:"                << _entry.stringValue(_tag); break;
-      case UDSEntry::UDS_TARGET_URL:         kDebug() << "UDS_TARGET_URL:"         << _entry.stringValue(_tag); break;
-      case UDSEntry::UDS_LINK_DEST:          kDebug() << "UDS_LINK_DEST:"          << _entry.stringValue(_tag); break;
-      case UDSEntry::UDS_SIZE:               kDebug() << "UDS_SIZE:"               << _entry.numberValue(_tag); break;
-      case UDSEntry::UDS_GUESSED_MIME_TYPE:  kDebug() << "UDS_GUESSED_MIME_TYPE:"  << _entry.stringValue(_tag); break;
-      case UDSEntry::UDS_ACCESS:             kDebug() << "UDS_ACCESS:"             << _entry.numberValue(_tag); break;
-      case UDSEntry::UDS_ICON_NAME:          kDebug() << "UDS_ICON_NAME:"          << _entry.stringValue(_tag); break;
-      case UDSEntry::UDS_ICON_OVERLAY_NAMES: kDebug() << "UDS_ICON_OVERLAY_NAMES:" << _entry.stringValue(_tag); break;
-      default:                               kDebug() << "UDS_<UNKNOWN>:"          << _tag;
-    } // switch
-  return _entry;
+    m_udsEntry.insert( UDSEntry::UDS_ICON_OVERLAY_NAMES, m_overlays.join(",") );
+  m_udsEntryValid = TRUE;
+  return m_udsEntry;
 } // NodeWrapper::toUDSEntry
 
 /*!
@@ -417,7 +626,7 @@ UDSEntry NodeWrapper::toUDSEntry ( ) const
  */
 QByteArray NodeWrapper::toJSON ( ) const
 {
-  kDebug() << m_name;
+  kTrace(T_NODE) << m_name;
   QVariantMap _object = QJson::QObjectHelper::qobject2qvariant( this );
   QJson::Serializer _serializer;
   return _serializer.serialize ( _object );
@@ -432,13 +641,16 @@ QByteArray NodeWrapper::toJSON ( ) const
  */
 NodeWrapper& NodeWrapper::fromJSON ( const QByteArray& json )
 {
-  kDebug();
+  kTrace(T_NODE);
   QJson::Parser parser;
   bool ok;
   QVariant _properties = parser.parse ( json, &ok ).toMap();
   if ( ! ok )
     throw Exception ( Error(ERR_INTERNAL), "Failed to deserialize json notation of node" );
   QJson::QObjectHelper::qvariant2qobject ( _properties.toMap(), this );
+  invalidateUDSEntry ( );
+  m_classified = TRUE;
+  m_payload    = QString ( );
 //  setSemantics(1);
   return *this;
 } // NodeWrapper::fromJSON
\ No newline at end of file
@@ -19,7 +19,7 @@
 #include <kio/udsentry.h>
 #include <kmimetype.h>
 #include <kdatetime.h>
-#include "utility/regex.h"
+#include "utility/hash.h"
 
 using namespace KIO;
 namespace KIO_CLIPBOARD
@@ -34,6 +34,7 @@ namespace KIO_CLIPBOARD
    *
    * The class has somewhat passive character: all data is treated more or less constant
    * - the private members hold basic information as detected, requested or decided upon
+   * - only name, index and size are set upon construction, all attributes depending on the payload are computed lazily on first access
    * - all private members are published via direct access methods (read only)
    * - in addition a number of convenience constructions are offered as methods as well
    *   these are generated based only on the constant settings stored in the members mentioned above
@@ -82,30 +83,36 @@ namespace KIO_CLIPBOARD
       int             m_type;
       QString         m_icon;
       QStringList     m_overlays;
+      // attributes depending on the payload are only worked out when first required
+      bool               m_classified;
+      QString            m_payload;
+      ClipboardFrontend* m_clipboard;
+      // description as handed out to the KIO system, built on first request and dropped whenever the node changes
+      mutable UDSEntry   m_udsEntry;
+      mutable bool       m_udsEntryValid;
     protected:
       int             m_mappingNameCardinality;
       int             m_mappingNameLength;
       QString         m_mappingNamePattern;
-      const regExPool m_regEx;
     protected:
       // member serialization interface
-      inline int              getIndex           ( ) { return m_index;                  };
-      inline const QString&   getTitle           ( ) { return m_title;                  };
-      inline int              getSize            ( ) { return m_size;                   };
-      inline const KDateTime& getDatetime        ( ) { return m_datetime;               };
-      inline QString          getMimetype        ( ) { return m_mimetype->name();       };
-      inline int              getAccess          ( ) { return m_access;                 };
-      inline Semantics        getSemantics       ( ) { return m_semantics;              };
-      inline const QString&   getName            ( ) { return m_name;                   };
-      inline QString          getUrl             ( ) { return m_url.prettyUrl();        };
-      inline QString          getLink            ( ) { return m_link.prettyUrl();       };
-      inline const QString&   getPath            ( ) { return m_path;                   };
-      inline int              getType            ( ) { return m_type;                   };
-      inline const QString&   getIcon            ( ) { return m_icon;                   };
-      inline QString          getOverlays        ( ) { return m_overlays.join(",");     };
-      inline int              getNameCardinality ( ) { return m_mappingNameCardinality; };
-      inline int              getNameLength      ( ) { return m_mappingNameLength;      };
-      inline const QString&   getNamePattern     ( ) { return m_mappingNamePattern;     };
+      inline int              getIndex           ( ) {                     return m_index;                  };
+      inline const QString&   getTitle           ( ) { ensureClassified(); return m_title;                  };
+      inline int              getSize            ( ) {                     return m_size;                   };
+      inline const KDateTime& getDatetime        ( ) { ensureClassified(); return m_datetime;               };
+      inline QString          getMimetype        ( ) { ensureClassified(); return m_mimetype->name();       };
+      inline int              getAccess          ( ) {                     return m_access;                 };
+      inline Semantics        getSemantics       ( ) { ensureClassified(); return m_semantics;              };
+      inline const QString&   getName            ( ) {                     return m_name;                   };
+      inline QString          getUrl             ( ) { ensureClassified(); return m_url.prettyUrl();        };
+      inline QString          getLink            ( ) { ensureClassified(); return m_link.prettyUrl();       };
+      inline const QString&   getPath            ( ) { ensureClassified(); return m_path;                   };
+      inline int              getType            ( ) { ensureClassified(); return m_type;                   };
+      inline const QString&   getIcon            ( ) { ensureClassified(); return m_icon;                   };
+      inline QString          getOverlays        ( ) { ensureClassified(); return m_overlays.join(",");     };
+      inline int              getNameCardinality ( ) {                     return m_mappingNameCardinality; };
+      inline int              getNameLength      ( ) {                     return m_mappingNameLength;      };
+      inline const QString&   getNamePattern     ( ) {                     return m_mappingNamePattern;     };
       // member deserialization interface
       inline void setIndex           ( int              index           ) { m_index                  = index;                         };
       inline void setTitle           ( const QString&   title           ) { m_title                  = title;                         };
@@ -125,26 +132,34 @@ namespace KIO_CLIPBOARD
       inline void setNameCardinality ( int              nameCardinality ) { m_mappingNameCardinality = nameCardinality;               };
       inline void setNameLength      ( int              nameLength      ) { m_mappingNameLength      = nameLength;                    };
       inline void setNamePattern     ( const QString&   namePattern     ) { m_mappingNamePattern     = namePattern;                   };
+      inline void invalidateUDSEntry ( ) { m_udsEntryValid = FALSE; m_udsEntry.clear(); };
+      void classify ( const QString& payload, int sniffLength );
+      void ensureClassified ( ) const;
+      void writeClassification ( QDataStream& stream ) const;
+      bool readClassification  ( QDataStream& stream );
     public:
       NodeWrapper ( ClipboardFrontend* const clipboard, int index, const QString& payload, QObject* parent=0 );
       NodeWrapper ( const QByteArray& json, QObject* parent=0 );
       NodeWrapper ( const NodeWrapper& node, QObject* parent=0 );
       NodeWrapper ( QObject* parent=0 );
       ~NodeWrapper ( );
-      inline int                   index     ( ) const { return m_index;     };
-      inline const QString&        title     ( ) const { return m_title;     };
-      inline int                   size      ( ) const { return m_size;      };
-      inline const KDateTime&      datetime  ( ) const { return m_datetime;  };
-      inline const KMimeType::Ptr& mimetype  ( ) const { return m_mimetype;  };
-      inline int                   access    ( ) const { return m_access;    };
-      inline const Semantics&      semantics ( ) const { return m_semantics; };
-      inline const QString&        name      ( ) const { return m_name;      };
-      inline const KUrl&           url       ( ) const { return m_url;       };
-      inline const KUrl&           link      ( ) const { return m_link;      };
-      inline const QString&        path      ( ) const { return m_path;      };
-      inline int                   type      ( ) const { return m_type;      };
-      inline const QString&        icon      ( ) const { return m_icon;      };
-      inline const QStringList&    overlays  ( ) const { return m_overlays;  };
+      inline int                   index     ( ) const {                     return m_index;     };
+      inline const QString&        title     ( ) const { ensureClassified(); return m_title;     };
+      inline int                   size      ( ) const {                     return m_size;      };
+      inline const KDateTime&      datetime  ( ) const { ensureClassified(); return m_datetime;  };
+      inline const KMimeType::Ptr& mimetype  ( ) const { ensureClassified(); return m_mimetype;  };
+      inline int                   access    ( ) const {                     return m_access;    };
+      inline const Semantics&      semantics ( ) const { ensureClassified(); return m_semantics; };
+      inline const QString&        name      ( ) const {                     return m_name;      };
+      inline const KUrl&           url       ( ) const { ensureClassified(); return m_url;       };
+      inline const KUrl&           link      ( ) const { ensureClassified(); return m_link;      };
+      inline const QString&        path      ( ) const { ensureClassified(); return m_path;      };
+      inline int                   type      ( ) const { ensureClassified(); return m_type;      };
+      inline const QString&        icon      ( ) const { ensureClassified(); return m_icon;      };
+      inline const QStringList&    overlays  ( ) const { ensureClassified(); return m_overlays;  };
+      inline int                   nameCardinality ( ) const { return m_mappingNameCardinality; };
+      inline bool                  isClassified    ( ) const { return m_classified;             };
+      void     setPosition     ( int index, int cardinality );
       QString  prettyIndex     ( ) const;
       QString  prettyMimetype  ( ) const;
       QString  prettySemantics ( ) const;
@@ -152,8 +167,12 @@ namespace KIO_CLIPBOARD
       QString  prettyUrl       ( ) const;
       QString  prettyDatetime  ( ) const;
              QString payload2title ( const QString& payload );
-      static QString payload2name  ( const QString& payload );
+      static QString payload2name  ( const QString& payload, PayloadHash strategy=H_MD5 );
       UDSEntry     toUDSEntry ( ) const;
+      QByteArray   toClassification   ( ) const;
+      bool         fromClassification ( const QByteArray& data );
+      void         toSnapshot         ( QDataStream& stream ) const;
+      bool         fromSnapshot       ( QDataStream& stream );
       QByteArray   toJSON ( ) const;
       NodeWrapper& fromJSON ( const QByteArray& json );
   }; // class NodeWrapper
@@ -14,14 +14,18 @@
 #include <kio/global.h>
 #include <kio/forwardingslavebase.h>
 #include <kio/udsentry.h>
+#include "utility/hash.h"
 #include "clipboard/klipper/klipper_frontend.h"
 
 using namespace KIO;
 namespace KIO_CLIPBOARD
 {
-  static       int     C_mappingNameCardinality  = 1;
-  static const int     C_mappingNameLength       = 60;
-  static const QString C_mappingNamePattern      = "%1[%2]:%3";
+  static       int         C_mappingNameCardinality  = 1;
+  static const int         C_mappingNameLength       = 60;
+  static const QString     C_mappingNamePattern      = "%1[%2]:%3";
+  static const PayloadHash C_mappingNameHash         = H_MD5;
+  static const int         C_mimetypeSniffLength     = 16*1024;
+  static const int         C_transferChunkLength     = 64*1024;
 
   /**
    * This class implements something like a 'meta slave', a slave that acts as a proxy to other, specialized slaves.
@@ -27,6 +27,7 @@
 #include "kio_klipper_protocol.h"
 #include "clipboard/clipboard_frontend.h"
 #include "utility/exception.h"
+#include "utility/instrumentation.h"
 
 // Kdebug::Block is only defined from KDE-4.6.0 on
 // we wrap it cause this appears to be the only requirement for KDE-4.6
@@ -129,6 +130,7 @@ const UDSEntryList KIOKlipperProtocol::toUDSEntryList ( )
 void KIOKlipperProtocol::copy ( const KUrl& src, const KUrl& dest, int permissions, JobFlags flags )
 {
   MY_KDEBUG_BLOCK ( "<copy>" );
+  InstrumentationTimer _timer ( "kio.copy" );
   kDebug() << src.prettyUrl() << dest.prettyUrl() << permissions << flags;
   kDebug() << QString("copy from '%1' to '%2' requested").arg(src.scheme()).arg(dest.scheme());
   try
@@ -159,12 +161,28 @@ void KIOKlipperProtocol::copy ( const KUrl& src, const KUrl& dest, int permissio
   catch ( Exception &e ) { error( e.getCode(), e.getText() ); }
 } // KIOKlipperProtocol::copy
 
+/*!
+ * KIOKlipperProtocol::progressed
+ * @brief Hands the progress of a lengthy clipboard operation on to the application and cancels it if the job has been killed.
+ * @param processed number of steps done so far
+ * @param total number of steps in total
+ * @author Christian Reiner
+ */
+void KIOKlipperProtocol::progressed ( int processed, int total )
+{
+  totalSize     ( total );
+  processedSize ( processed );
+  if ( wasKilled() )
+    m_clipboard->backend()->cancel ( );
+} // KIOKlipperProtocol::progressed
+
 /*!
  * KIOKlipperProtocol::del
  * @brief Request to remove an entry from the clipboad.
  * @param url url of item to be deleted
  * @param isfile flag indication of the item is a file (and not a folder)
  * We let the clipboard wrapper handle the real work. 
+ * Klipper has to be repopulated for that, the progress of that is reported and the job can be killed meanwhile.
  * @author Christian Reiner
  */
 void KIOKlipperProtocol::del ( const KUrl& url, bool isfile )
@@ -172,7 +190,9 @@ void KIOKlipperProtocol::del ( const KUrl& url, bool isfile )
   // note: isfile signals if a directory or a file is meant to be deleted
   // this does make little sense for a clipboard, since it is just a string anyway
   MY_KDEBUG_BLOCK ( "<del>" );
+  InstrumentationTimer _timer ( "kio.del" );
   kDebug() << url.prettyUrl ( ) << isfile;
+  connect ( m_clipboard->backend(), SIGNAL(progress(int,int)), this, SLOT(progressed(int,int)) );
   try
   {
     // remove entry from clipboard
@@ -180,6 +200,7 @@ void KIOKlipperProtocol::del ( const KUrl& url, bool isfile )
     finished();
   }
   catch ( Exception &e ) { error( e.getCode(), e.getText() ); }
+  disconnect ( m_clipboard->backend(), SIGNAL(progress(int,int)), this, SLOT(progressed(int,int)) );
 } // KIOKlipperProtocol::del
 
 /*!
@@ -196,6 +217,7 @@ void KIOKlipperProtocol::del ( const KUrl& url, bool isfile )
 void KIOKlipperProtocol::get ( const KUrl& url )
 {
   MY_KDEBUG_BLOCK ( "<get>" );
+  InstrumentationTimer _timer ( "kio.get" );
   kDebug() << url.prettyUrl ( ) ;
   KUrl _url;
   try
@@ -207,11 +229,16 @@ void KIOKlipperProtocol::get ( const KUrl& url )
       case KIO_CLIPBOARD::NodeWrapper::S_EMPTY:
       case KIO_CLIPBOARD::NodeWrapper::S_TEXT:
       case KIO_CLIPBOARD::NodeWrapper::S_CODE:
-        mimeType ( _entry->mimetype()->name() );
-        data     ( m_clipboard->getClipboardEntry(_entry->index()).toUtf8() );
-        data     ( QByteArray() );
-        finished ( );
+      {
+        // fetching the payload might refresh the nodes and delete the entry, so it is not touched afterwards
+        const QString _mimetype = _entry->mimetype()->name();
+        const QString _payload  = m_clipboard->getNodePayload ( _entry );
+        _entry = 0;
+        mimeType    ( _mimetype );
+        sendContent ( _payload );
+        finished    ( );
         return;
+      }
       case KIO_CLIPBOARD::NodeWrapper::S_FILE:
       case KIO_CLIPBOARD::NodeWrapper::S_DIR:
         _url = KUrl(_entry->path() );
@@ -236,11 +263,16 @@ void KIOKlipperProtocol::get ( const KUrl& url )
  * KIOKlipperProtocol::listDir
  * @brief Lists all clipboard entries as present in the clipboard wrapper.
  * @param url url of folder to be listed
+ * The number of entries is announced right after the refresh, before any node gets classified.
+ * Entries are then handed out one by one in history order, each node is classified just before its entry is listed.
+ * That way the first entries show up whilst the remaining ones are still being worked on.
+ * Once the listing is finished the classifications and the nodes are published for other slaves.
  * @author Christian Reiner
  */
 void KIOKlipperProtocol::listDir ( const KUrl& url )
 {
   MY_KDEBUG_BLOCK ( "<listDir>" );
+  InstrumentationTimer _timer ( "kio.listDir" );
   kDebug() << url.prettyUrl ( );
   try
   {
@@ -252,10 +284,21 @@ void KIOKlipperProtocol::listDir ( const KUrl& url )
       finished ( );
       return;
     }
+    // the refresh does not classify any node, so the first entry is sent after classifying just that one
+    InstrumentationTimer _first ( "kio.listDir.first" );
     m_clipboard->refreshNodes ( );
     totalSize ( m_clipboard->countNodes() );
-    listEntries ( toUDSEntryList() );
+    foreach ( const NodeWrapper* _node, m_clipboard->nodes().positions() )
+    {
+      listEntry ( _node->toUDSEntry(), FALSE );
+      _first.stop ( );
+    }
+    listEntry ( UDSEntry(), TRUE );
     finished ( );
+    // other slaves benefit from the classifications made for this listing, the application does not wait for that
+    _timer.stop ( );
+    m_clipboard->publishClassifications ( );
+    m_clipboard->publishNodes ( );
   }
   catch ( Exception &e ) { error( e.getCode(), e.getText() ); }
 } // KIOKlipperProtocol::listDir
@@ -358,21 +401,46 @@ void KIOKlipperProtocol::put ( const KUrl& url, int permissions, KIO::JobFlags f
   // FIXME: it has to be source specific instead ! and a full path, not just a file name
   // note: permissions and flags (OVERWRITE) dont make sense for a local clipboard
   MY_KDEBUG_BLOCK ( "<put>" );
+  InstrumentationTimer _timer ( "kio.put" );
   kDebug() << url.prettyUrl ( ) << permissions << flags;
   try
   {
     // we want to push an entry to the clipboard, but this is the _content_ of the url, not the name
+    // reject content exceeding the clipboards limit as early as possible, if announced by its size even before reading
+    const qint64 _limit = m_clipboard->limit();
+    bool _announced;
+    const qint64 _size = metaData("size").toLongLong ( &_announced );
+    if ( _announced && _size>_limit )
+      throw Exception ( Error(ERR_SLAVE_DEFINED), i18n("The size of %1 bytes exceeds the clipboards limit of %2 bytes.", _size, _limit) );
+    // collect the chunks as they arrive, they are joined only once in the end
+    QList<QByteArray> _chunks;
+    qint64 _received = 0;
     int _ret_val;
-    QByteArray _buffer, _payload;
     do
     {
+      QByteArray _buffer;
       dataReq();
-      int _ret_val = readData ( _buffer );
+      _ret_val = readData ( _buffer );
       if  ( _ret_val<0 )
         throw Exception ( Error(ERR_COULD_NOT_READ), url.prettyUrl() ); // FIXME: show source file instead of target file
-      _payload += _buffer;
-    } while ( _ret_val!=0 && m_clipboard->limit()>_payload.size() ); // a return value of 0 (zero) means: no more data
-    m_clipboard->pushEntry ( QString(_payload) );
+      _received += _buffer.size();
+      if ( _received>_limit )
+        throw Exception ( Error(ERR_SLAVE_DEFINED), i18n("The size of the content exceeds the clipboards limit of %1 bytes.", _limit) );
+      if ( ! _buffer.isEmpty() )
+        _chunks << _buffer;
+    } while ( 0!=_ret_val ); // a return value of 0 (zero) means: no more data
+    QByteArray _payload;
+    if ( 1==_chunks.size() )
+      _payload = _chunks.first();
+    else
+    {
+      _payload.reserve ( _received );
+      foreach ( const QByteArray& _chunk, _chunks )
+        _payload.append ( _chunk );
+    }
+    _chunks.clear ( );
+    instrumentCount ( "bytes.received", _received );
+    m_clipboard->pushEntry ( QString::fromUtf8(_payload.constData(),_payload.size()) );
     finished ( );
   }
   catch ( Exception &e ) { error ( e.getCode(), e.getText() ); }
@@ -390,6 +458,7 @@ void KIOKlipperProtocol::put ( const KUrl& url, int permissions, KIO::JobFlags f
 void KIOKlipperProtocol::stat ( const KUrl& url )
 {
   MY_KDEBUG_BLOCK ( "<stat>" );
+  InstrumentationTimer _timer ( "kio.stat" );
   kDebug() << url.prettyUrl ( );
   try
   {
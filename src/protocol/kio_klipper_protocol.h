@@ -39,7 +39,8 @@ namespace KIO_CLIPBOARD
     , public KIOProtocol
   {
     Q_OBJECT
-    private:
+    private slots:
+      void progressed ( int processed, int total );
     protected:
       const UDSEntry     toUDSEntry ( );
       const UDSEntryList toUDSEntryList ( );
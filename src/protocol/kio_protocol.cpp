@@ -13,12 +13,16 @@
  */
 
 #include <QFile>
+#include <QTextCodec>
+#include <QTextEncoder>
 #include <kmimetype.h>
 #include <kio/netaccess.h>
 #include <kdebug.h>
 #include "utility/exception.h"
 #include "clipboard/klipper/klipper_frontend.h"
+#include "protocol/kio_clipboard_protocol.h"
 #include "kio_protocol.h"
+#include "utility/instrumentation.h"
 
 using namespace KIO;
 using namespace KIO_CLIPBOARD;
@@ -45,11 +49,14 @@ KIOProtocol::KIOProtocol ( const QByteArray& pool, const QByteArray& app, Clipbo
 /*!
  * KIOProtocol::KIOProtocol
  * @brief Standard destructor of class KIOProtocol.
+ * This is the last point in the life of a slave where KGlobal is still alive, so the instrumentation is dumped here.
  * @author Christian Reiner
  */
 KIOProtocol::~KIOProtocol ( )
 {
   kDebug() << "destructing protocol";
+  if ( isInstrumented() )
+    Instrumentation::instance().dump ( );
 } // KIOProtocol::~KIOProtocol
 
 /*!
@@ -225,22 +232,118 @@ void KIOProtocol::copyFromFile_Reference ( const QString& path )
  * KIOProtocol::copyFromFile_Content
  * @brief Pushes the content of a file onto the clipboard.
  * There is no check for filesize, this has already been dealt with in the calling copyFile()
+ * The file is mapped into memory and decoded straight from there, so its content is not copied before decoding.
+ * Files that cannot be mapped (like pipes or special files) are read in large blocks instead.
  * @author Christian Reiner
  */
 void KIOProtocol::copyFromFile_Content ( const KUrl& url )
 {
   kDebug() << url.prettyUrl();
-  // open file and buffer content as payload for a 'push'
-  QByteArray _payload, _buffer;
   QFile _file ( url.path() );
   if ( ! _file.open(QIODevice::ReadOnly) )
     throw Exception ( Error(ERR_COULD_NOT_READ), url.prettyUrl() );
-  // read content into buffer, push buffer onto clipboard
-  do
+  QString _payload;
+  qint64 _read = 0;
+  const qint64 _size = _file.size ( );
+  uchar* _mapping = ( 0<_size ) ? _file.map(0,_size) : 0;
+  if ( _mapping )
   {
-    _buffer   = _file.read ( 1024 );
-    _payload += _buffer;
-  } while ( ! _file.atEnd() && _buffer!=QByteArray() );
+    _payload = QString::fromUtf8 ( reinterpret_cast<const char*>(_mapping), _size );
+    _read    = _size;
+    _file.unmap ( _mapping );
+  }
+  else
+  {
+    kDebug() << "file cannot be mapped, reading it instead";
+    QByteArray _buffer;
+    _buffer.reserve ( qMax(qint64(0),_size) );
+    do
+    {
+      const QByteArray _block = _file.read ( C_transferChunkLength );
+      if ( _block.isEmpty() )
+        break;
+      _buffer.append ( _block );
+    } while ( ! _file.atEnd() );
+    if ( QFile::NoError!=_file.error() )
+      throw Exception ( Error(ERR_COULD_NOT_READ), url.prettyUrl() );
+    _payload = QString::fromUtf8 ( _buffer.constData(), _buffer.size() );
+    _read    = _buffer.size ( );
+  }
   _file.close();
-  m_clipboard->pushEntry ( QString(_payload) );
+  instrumentCount ( "bytes.received", _read );
+  m_clipboard->pushEntry ( _payload );
 } // KIOProtocol::copyFromFileContent
+
+/*!
+ * utf8Length
+ * @brief Computes the length of the UTF-8 notation of a string without actually converting it.
+ * @param string string to be measured
+ * @return number of bytes of the UTF-8 notation
+ * Unpaired surrogates are counted as the replacement character they get converted into.
+ * @author Christian Reiner
+ */
+static qint64 utf8Length ( const QString& string )
+{
+  qint64 _length = 0;
+  const QChar* _char = string.constData();
+  const QChar* _end  = _char + string.size();
+  for ( ; _char<_end; ++_char )
+  {
+    const ushort _code = _char->unicode();
+    if ( 0x80>_code )
+      _length += 1;
+    else if ( 0x800>_code )
+      _length += 2;
+    else if ( _char->isHighSurrogate() && _char+1<_end && (_char+1)->isLowSurrogate() )
+    {
+      _length += 4;
+      ++_char;
+    }
+    else
+      _length += 3;
+  }
+  return _length;
+} // utf8Length
+
+/*!
+ * KIOProtocol::sendContent
+ * @brief Sends a payload as the content of a get request.
+ * @param payload content to be sent
+ * The payload is converted to UTF-8 and sent chunk by chunk, so the complete UTF-8 notation is never held in memory.
+ * The total size is announced upfront and the progress is reported after each chunk.
+ * The encoder keeps its state between chunks, so surrogate pairs split by a chunk border are converted correctly.
+ * It must not write a byte order mark, that would precede the content and spoil the total size announced.
+ * @author Christian Reiner
+ */
+void KIOProtocol::sendContent ( const QString& payload )
+{
+  const qint64 _total = utf8Length ( payload );
+  kDebug() << payload.size() << "characters," << _total << "bytes";
+  totalSize ( _total );
+#if QT_VERSION >= 0x040700
+  QTextEncoder* _encoder = QTextCodec::codecForName("UTF-8")->makeEncoder ( QTextCodec::IgnoreHeader );
+#endif
+  qint64 _processed = 0;
+  for ( int _position=0; _position<payload.size(); _position+=C_transferChunkLength )
+  {
+#if QT_VERSION >= 0x040700
+    const QByteArray _chunk = _encoder->fromUnicode ( payload.constData()+_position, qMin(C_transferChunkLength,payload.size()-_position) );
+#else
+    // encoders cannot be told to omit the byte order mark before Qt 4.7, so chunks are converted on their own
+    // a surrogate pair split by the chunk border is kept together by converting it with the previous chunk
+    int _length = qMin ( C_transferChunkLength, payload.size()-_position );
+    if ( _position+_length<payload.size() && payload.at(_position+_length-1).isHighSurrogate() )
+      ++_length;
+    const QByteArray _chunk = payload.mid(_position,_length).toUtf8 ( );
+    _position += _length - C_transferChunkLength;
+#endif
+    data ( _chunk );
+    _processed += _chunk.size();
+    processedSize ( _processed );
+  }
+#if QT_VERSION >= 0x040700
+  delete _encoder;
+#endif
+  data ( QByteArray() );
+  instrumentCount ( "bytes.sent", _processed );
+} // KIOProtocol::sendContent
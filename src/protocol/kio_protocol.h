@@ -52,6 +52,7 @@ namespace KIO_CLIPBOARD
       void copyFromFile_Reference ( const KUrl&    url );
       void copyFromFile_Reference ( const QString& path );
       void copyFromFile_Content   ( const KUrl&    url );
+      void sendContent            ( const QString& payload );
     public:
       //virtual void copy     ( const KUrl& src, const KUrl& dest, int permissions, JobFlags flags ) = 0;
       virtual void del      ( const KUrl& url, bool isfile ) = 0;
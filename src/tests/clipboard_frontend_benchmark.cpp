@@ -0,0 +1,123 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Benchmark of refreshing the nodes of class ClipboardFrontend
+ * @see ClipboardFrontendBenchmark
+ * @author Christian Reiner
+ */
+
+#include <QtTest>
+#include <QStringList>
+#include <qtest_kde.h>
+#include <kshareddatacache.h>
+#include "tests/test_frontend.h"
+
+using namespace KIO_CLIPBOARD;
+
+/*!
+ * class ClipboardFrontendBenchmark
+ * @brief Measures the cost of a refresh of 1000 nodes as a function of the number of entries changed since the last one.
+ * Each iteration swaps the history between two variants differing in that number of entries,
+ * so each refresh constructs that many nodes and deletes that many others, all remaining nodes are reused.
+ * Rebuilding all nodes on every refresh, which is what a refresh cost before, is measured as the baseline.
+ * @author Christian Reiner
+ */
+class ClipboardFrontendBenchmark
+  : public QObject
+{
+  Q_OBJECT
+  private:
+    enum { C_entries = 1000 };
+    static QStringList changed ( int count );
+  private slots:
+    void initTestCase ( );
+    void refreshed_data ( );
+    void refreshed      ( );
+    void rebuilt        ( );
+}; // class ClipboardFrontendBenchmark
+
+/*!
+ * ClipboardFrontendBenchmark::changed
+ * @brief The history with its newest entries replaced by entries not contained in it before.
+ * @param count number of entries replaced
+ * @return payloads, newest first
+ * @author Christian Reiner
+ */
+QStringList ClipboardFrontendBenchmark::changed ( int count )
+{
+  return TestFrontend::history(count,100000) + TestFrontend::history(C_entries).mid ( count );
+} // ClipboardFrontendBenchmark::changed
+
+/*!
+ * ClipboardFrontendBenchmark::initTestCase
+ * @brief Removes nodes published by former runs, a refresh would start off with them otherwise.
+ * @author Christian Reiner
+ */
+void ClipboardFrontendBenchmark::initTestCase ( )
+{
+  KSharedDataCache::deleteCache ( QString("kio-clipboard-test") );
+} // ClipboardFrontendBenchmark::initTestCase
+
+/*!
+ * ClipboardFrontendBenchmark::refreshed_data
+ * @brief Number of entries changed between two refreshes, from none up to all of them.
+ * @author Christian Reiner
+ */
+void ClipboardFrontendBenchmark::refreshed_data ( )
+{
+  QTest::addColumn<int> ( "count" );
+  QTest::newRow ( "0 of 1000 changed" )    << 0;
+  QTest::newRow ( "1 of 1000 changed" )    << 1;
+  QTest::newRow ( "10 of 1000 changed" )   << 10;
+  QTest::newRow ( "100 of 1000 changed" )  << 100;
+  QTest::newRow ( "1000 of 1000 changed" ) << 1000;
+} // ClipboardFrontendBenchmark::refreshed_data
+
+/*!
+ * ClipboardFrontendBenchmark::refreshed
+ * @brief Refreshes the nodes after the given number of entries has changed.
+ * @author Christian Reiner
+ */
+void ClipboardFrontendBenchmark::refreshed ( )
+{
+  QFETCH ( int, count );
+  const QStringList _histories[2] = { TestFrontend::history(C_entries), changed(count) };
+  TestFrontend _clipboard ( _histories[0] );
+  _clipboard.refreshNodes ( );
+  int _swap = 0;
+  QBENCHMARK
+  {
+    _swap = 1 - _swap;
+    _clipboard.setEntries ( _histories[_swap] );
+    _clipboard.refreshNodes ( );
+  }
+  QCOMPARE ( _clipboard.nodes().size(), int(C_entries) );
+  QCOMPARE ( _clipboard.nodes().at(0)->name(),
+             NodeWrapper::payload2name(_histories[_swap].first(),_clipboard.mappingNameHash()) );
+} // ClipboardFrontendBenchmark::refreshed
+
+/*!
+ * ClipboardFrontendBenchmark::rebuilt
+ * @brief Drops all nodes before each refresh, so all of them are constructed again.
+ * @author Christian Reiner
+ */
+void ClipboardFrontendBenchmark::rebuilt ( )
+{
+  TestFrontend _clipboard ( TestFrontend::history(C_entries) );
+  QBENCHMARK
+  {
+    _clipboard.clearNodes ( );
+    _clipboard.refreshNodes ( );
+  }
+  QCOMPARE ( _clipboard.nodes().size(), int(C_entries) );
+} // ClipboardFrontendBenchmark::rebuilt
+
+QTEST_KDEMAIN ( ClipboardFrontendBenchmark, NoGUI )
+
+#include "clipboard_frontend_benchmark.moc"
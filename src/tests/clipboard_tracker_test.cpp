@@ -0,0 +1,272 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Unit test of the change tracking of class ClipboardTracker against the mock klipper
+ * @see ClipboardTrackerTest
+ * @author Christian Reiner
+ */
+
+#include <signal.h>
+#include <unistd.h>
+#include <QtTest>
+#include <QScopedPointer>
+#include <QTime>
+#include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusInterface>
+#include <qtest_kde.h>
+#include "clipboard/clipboard_tracker.h"
+#include "tests/test_bus.h"
+
+using namespace KIO_CLIPBOARD;
+
+/*!
+ * class ClipboardTrackerTest
+ * @brief Checks that changes of the clipboard are counted exactly once and views are notified exactly once,
+ * however many signals and slaves there are, and that tracking is disabled for clipboards it cannot rely on.
+ * The mock klipper runs on a private bus, each test uses a generation counter of its own.
+ * @author Christian Reiner
+ */
+class ClipboardTrackerTest
+  : public QObject
+{
+  Q_OBJECT
+  private:
+    TestBus           m_bus;
+    QString           m_key;
+    int               m_test;
+    int               m_notified;
+    ClipboardTracker* tracker ( ) const;
+    void change ( int times=1 );
+    static void settle ( );
+  private slots:
+    void initTestCase       ( );
+    void init               ( );
+    void cleanup            ( );
+    void signalCountedOnce  ( );
+    void sharedCountedOnce  ( );
+    void counterRestarted   ( );
+    void restartCounted     ( );
+    void signalMissing      ( );
+    void serviceHanging     ( );
+  public slots:
+    void filesAdded ( const QString& directory );
+}; // class ClipboardTrackerTest
+
+/*!
+ * ClipboardTrackerTest::tracker
+ * @brief Constructs a tracker of the mock klipper, using the generation counter of the current test.
+ * @return tracker, owned by the caller
+ * @author Christian Reiner
+ */
+ClipboardTracker* ClipboardTrackerTest::tracker ( ) const
+{
+  return new ClipboardTracker ( KUrl("klipper:/"), m_key,
+                                "org.kde.klipper", "/klipper", "org.kde.klipper.klipper", "clipboardHistoryUpdated" );
+} // ClipboardTrackerTest::tracker
+
+/*!
+ * ClipboardTrackerTest::change
+ * @brief Changes the history of the mock klipper, each change makes it emit its change signal.
+ * @param times number of changes
+ * @author Christian Reiner
+ */
+void ClipboardTrackerTest::change ( int times )
+{
+  QDBusInterface _klipper ( "org.kde.klipper", "/klipper", "org.kde.klipper.klipper" );
+  for ( int _time=0; _time<times; _time++ )
+    _klipper.call ( "setClipboardContents", QString("change %1 of test %2").arg(_time).arg(m_test) );
+  settle ( );
+} // ClipboardTrackerTest::change
+
+/*!
+ * ClipboardTrackerTest::settle
+ * @brief Gives signals on their way on the bus the time to arrive, they are queued until the next poll.
+ * @author Christian Reiner
+ */
+void ClipboardTrackerTest::settle ( )
+{
+  QTest::qWait ( 200 );
+} // ClipboardTrackerTest::settle
+
+/*!
+ * ClipboardTrackerTest::filesAdded
+ * @brief Counts the notifications of views showing the clipboard.
+ * @param directory url views are told to update
+ * @author Christian Reiner
+ */
+void ClipboardTrackerTest::filesAdded ( const QString& directory )
+{
+  if ( KUrl(directory)==KUrl("klipper:/") )
+    ++m_notified;
+} // ClipboardTrackerTest::filesAdded
+
+/*!
+ * ClipboardTrackerTest::initTestCase
+ * @brief Starts the private bus and the mock klipper and listens to the notifications of views.
+ * @author Christian Reiner
+ */
+void ClipboardTrackerTest::initTestCase ( )
+{
+  m_test = 0;
+  QVERIFY ( m_bus.start() );
+  QVERIFY ( m_bus.startKlipper() );
+  QVERIFY ( QDBusConnection::sessionBus().connect(QString(),QString(),"org.kde.KDirNotify","FilesAdded",
+                                                  this,SLOT(filesAdded(QString))) );
+} // ClipboardTrackerTest::initTestCase
+
+/*!
+ * ClipboardTrackerTest::init
+ * @brief Uses a fresh generation counter for the test, so generations of former tests or runs do not interfere.
+ * @author Christian Reiner
+ */
+void ClipboardTrackerTest::init ( )
+{
+  m_key      = QString ( "kio-clipboard-tracker-test-%1-%2" ).arg(QCoreApplication::applicationPid()).arg(++m_test);
+  m_notified = 0;
+} // ClipboardTrackerTest::init
+
+/*!
+ * ClipboardTrackerTest::cleanup
+ * @brief Nothing to clean up, the counter vanishes with the last tracker of the test.
+ * @author Christian Reiner
+ */
+void ClipboardTrackerTest::cleanup ( )
+{
+} // ClipboardTrackerTest::cleanup
+
+/*!
+ * ClipboardTrackerTest::signalCountedOnce
+ * @brief Several signals received at once count as a single change and views are notified once.
+ * @author Christian Reiner
+ */
+void ClipboardTrackerTest::signalCountedOnce ( )
+{
+  QScopedPointer<ClipboardTracker> _tracker ( tracker() );
+  QVERIFY ( _tracker->isTracking() );
+  const int _generation = _tracker->generation ( );
+  QVERIFY ( 0<_generation );
+  change ( 3 );
+  _tracker->poll ( );
+  QCOMPARE ( _tracker->generation(), _generation+1 );
+  settle ( );
+  QCOMPARE ( m_notified, 1 );
+  // nothing changed since
+  _tracker->poll ( );
+  settle ( );
+  QCOMPARE ( _tracker->generation(), _generation+1 );
+  QCOMPARE ( m_notified, 1 );
+} // ClipboardTrackerTest::signalCountedOnce
+
+/*!
+ * ClipboardTrackerTest::sharedCountedOnce
+ * @brief Two trackers sharing a cache, as two slaves do, count a change once and notify views once.
+ * @author Christian Reiner
+ */
+void ClipboardTrackerTest::sharedCountedOnce ( )
+{
+  QScopedPointer<ClipboardTracker> _first  ( tracker() );
+  QScopedPointer<ClipboardTracker> _second ( tracker() );
+  QVERIFY ( _first->isTracking() && _second->isTracking() );
+  const int _generation = _first->generation ( );
+  change ( );
+  _first->poll ( );
+  _second->poll ( );
+  settle ( );
+  QCOMPARE ( _first->generation(),  _generation+1 );
+  QCOMPARE ( _second->generation(), _generation+1 );
+  QCOMPARE ( m_notified, 1 );
+  // the second tracker took over the generation, so it counts the next change itself
+  change ( );
+  _second->poll ( );
+  _first->poll ( );
+  settle ( );
+  QCOMPARE ( _first->generation(), _generation+2 );
+  QCOMPARE ( m_notified, 2 );
+} // ClipboardTrackerTest::sharedCountedOnce
+
+/*!
+ * ClipboardTrackerTest::counterRestarted
+ * @brief A counter created anew, once the last tracker is gone, does not repeat the generations of the former counter.
+ * Snapshots of the nodes outlive the trackers, a repeated generation would make a stale snapshot look current.
+ * @author Christian Reiner
+ */
+void ClipboardTrackerTest::counterRestarted ( )
+{
+  int _generation;
+  {
+    QScopedPointer<ClipboardTracker> _tracker ( tracker() );
+    QVERIFY ( _tracker->isTracking() );
+    change ( );
+    _tracker->poll ( );
+    _generation = _tracker->generation ( );
+  }
+  QTest::qWait ( 10 );
+  QScopedPointer<ClipboardTracker> _tracker ( tracker() );
+  QVERIFY ( _tracker->isTracking() );
+  QVERIFY ( 0<_tracker->generation() );
+  QVERIFY ( _generation!=_tracker->generation() );
+  QVERIFY ( _generation-1!=_tracker->generation() );
+} // ClipboardTrackerTest::counterRestarted
+
+/*!
+ * ClipboardTrackerTest::restartCounted
+ * @brief A restart of the clipboard service counts as a single change, even without a change signal.
+ * @author Christian Reiner
+ */
+void ClipboardTrackerTest::restartCounted ( )
+{
+  QScopedPointer<ClipboardTracker> _tracker ( tracker() );
+  QVERIFY ( _tracker->isTracking() );
+  const int _generation = _tracker->generation ( );
+  QVERIFY ( m_bus.startKlipper() );
+  settle ( );
+  _tracker->poll ( );
+  QCOMPARE ( _tracker->generation(), _generation+1 );
+  settle ( );
+  QCOMPARE ( m_notified, 1 );
+} // ClipboardTrackerTest::restartCounted
+
+/*!
+ * ClipboardTrackerTest::signalMissing
+ * @brief Tracking is disabled for a clipboard not offering the change signal, like older versions of klipper.
+ * @author Christian Reiner
+ */
+void ClipboardTrackerTest::signalMissing ( )
+{
+  QVERIFY ( m_bus.startKlipper(QStringList()<<"--no-signal") );
+  QScopedPointer<ClipboardTracker> _tracker ( tracker() );
+  QVERIFY ( ! _tracker->isTracking() );
+  QCOMPARE ( _tracker->generation(), -1 );
+  change ( );
+  _tracker->poll ( );
+  QCOMPARE ( _tracker->generation(), -1 );
+  QCOMPARE ( m_notified, 0 );
+  QVERIFY ( m_bus.startKlipper() );
+} // ClipboardTrackerTest::signalMissing
+
+/*!
+ * ClipboardTrackerTest::serviceHanging
+ * @brief A clipboard not answering holds up the construction for no longer than the introspection timeout.
+ * @author Christian Reiner
+ */
+void ClipboardTrackerTest::serviceHanging ( )
+{
+  QVERIFY ( 0==::kill(m_bus.klipperPid(),SIGSTOP) );
+  QTime _clock;
+  _clock.start ( );
+  QScopedPointer<ClipboardTracker> _tracker ( tracker() );
+  const int _elapsed = _clock.elapsed ( );
+  ::kill ( m_bus.klipperPid(), SIGCONT );
+  QVERIFY ( ! _tracker->isTracking() );
+  QVERIFY2 ( _elapsed<2000, qPrintable(QString("construction took %1 ms").arg(_elapsed)) );
+} // ClipboardTrackerTest::serviceHanging
+
+QTEST_KDEMAIN ( ClipboardTrackerTest, NoGUI )
+
+#include "clipboard_tracker_test.moc"
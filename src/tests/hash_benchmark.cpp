@@ -0,0 +1,78 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Micro benchmark of the payload hashes naming the nodes
+ * @see HashBenchmark
+ * @author Christian Reiner
+ */
+
+#include <QtTest>
+#include <qtest_kde.h>
+#include "utility/hash.h"
+#include "tests/test_throughput.h"
+
+using namespace KIO_CLIPBOARD;
+
+Q_DECLARE_METATYPE ( KIO_CLIPBOARD::PayloadHash )
+
+/*!
+ * class HashBenchmark
+ * @brief Measures the throughput of both hash strategies on payloads from a few bytes up to several megabytes.
+ * Every entry is hashed on every refresh of the nodes, so this is what naming the nodes costs per byte of the history.
+ * The throughput is printed in GB/s of UTF-16 payload, see TestThroughput.
+ * @author Christian Reiner
+ */
+class HashBenchmark
+  : public QObject
+{
+  Q_OBJECT
+  private slots:
+    void payloadHash_data ( );
+    void payloadHash      ( );
+}; // class HashBenchmark
+
+/*!
+ * HashBenchmark::payloadHash_data
+ * @brief Both strategies on payloads of 64 characters up to 4 megacharacters.
+ * @author Christian Reiner
+ */
+void HashBenchmark::payloadHash_data ( )
+{
+  QTest::addColumn<PayloadHash> ( "strategy" );
+  QTest::addColumn<int>         ( "size" );
+  const int _sizes[] = { 64, 1024, 64*1024, 4*1024*1024 };
+  for ( unsigned int _size=0; _size<sizeof(_sizes)/sizeof(int); _size++ )
+  {
+    QTest::newRow ( qPrintable(QString("md5, %1 characters").arg(_sizes[_size])) )     << H_MD5     << _sizes[_size];
+    QTest::newRow ( qPrintable(QString("murmur3, %1 characters").arg(_sizes[_size])) ) << H_MURMUR3 << _sizes[_size];
+  }
+} // HashBenchmark::payloadHash_data
+
+/*!
+ * HashBenchmark::payloadHash
+ * @brief Hashes a payload of plain text.
+ * @author Christian Reiner
+ */
+void HashBenchmark::payloadHash ( )
+{
+  QFETCH ( PayloadHash, strategy );
+  QFETCH ( int, size );
+  const QString _payload = QString("The quick brown fox jumps over the lazy dog. ").repeated(1+size/45).left ( size );
+  QCOMPARE ( KIO_CLIPBOARD::payloadHash(_payload,strategy).size(), 32 );
+  TestThroughput _throughput ( QTest::currentDataTag() );
+  QBENCHMARK
+  {
+    KIO_CLIPBOARD::payloadHash ( _payload, strategy );
+    _throughput.add ( _payload.size()*sizeof(QChar) );
+  }
+} // HashBenchmark::payloadHash
+
+QTEST_KDEMAIN ( HashBenchmark, NoGUI )
+
+#include "hash_benchmark.moc"
@@ -0,0 +1,96 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Micro benchmark of the overhead of the instrumentation on the hot paths
+ * @see InstrumentationBenchmark
+ * @author Christian Reiner
+ */
+
+#include <QtTest>
+#include <qtest_kde.h>
+#include "utility/instrumentation.h"
+
+using namespace KIO_CLIPBOARD;
+
+/*!
+ * class InstrumentationBenchmark
+ * @brief Measures what timers and counters placed on the hot paths cost, 10000 of them per iteration.
+ * The benchmark is run twice, with instrumentation disabled, which is what every user pays,
+ * and enabled by the environment variable KIO_CLIPBOARD_INSTRUMENTATION, see the CMake file.
+ * @author Christian Reiner
+ */
+class InstrumentationBenchmark
+  : public QObject
+{
+  Q_OBJECT
+  private:
+    enum { C_calls = 10000 };
+  private slots:
+    void initTestCase ( );
+    void timer        ( );
+    void namedTimer   ( );
+    void counter      ( );
+}; // class InstrumentationBenchmark
+
+/*!
+ * InstrumentationBenchmark::initTestCase
+ * @brief Tells which of both runs this is.
+ * @author Christian Reiner
+ */
+void InstrumentationBenchmark::initTestCase ( )
+{
+  qDebug ( "instrumentation %s", isInstrumented() ? "enabled" : "disabled" );
+} // InstrumentationBenchmark::initTestCase
+
+/*!
+ * InstrumentationBenchmark::timer
+ * @brief Timers of a fixed operation, like those of the protocol commands.
+ * @author Christian Reiner
+ */
+void InstrumentationBenchmark::timer ( )
+{
+  QBENCHMARK
+  {
+    for ( int _call=0; _call<C_calls; _call++ )
+      InstrumentationTimer _timer ( "benchmark.timer" );
+  }
+} // InstrumentationBenchmark::timer
+
+/*!
+ * InstrumentationBenchmark::namedTimer
+ * @brief Timers with an assembled name, like those of the clipboard methods.
+ * @author Christian Reiner
+ */
+void InstrumentationBenchmark::namedTimer ( )
+{
+  const QString _name ( "namedTimer" );
+  QBENCHMARK
+  {
+    for ( int _call=0; _call<C_calls; _call++ )
+      InstrumentationTimer _timer ( "benchmark.", _name );
+  }
+} // InstrumentationBenchmark::namedTimer
+
+/*!
+ * InstrumentationBenchmark::counter
+ * @brief Counters, like those of the cache hits and misses.
+ * @author Christian Reiner
+ */
+void InstrumentationBenchmark::counter ( )
+{
+  QBENCHMARK
+  {
+    for ( int _call=0; _call<C_calls; _call++ )
+      instrumentCount ( "benchmark.counter" );
+  }
+} // InstrumentationBenchmark::counter
+
+QTEST_KDEMAIN ( InstrumentationBenchmark, NoGUI )
+
+#include "instrumentation_benchmark.moc"
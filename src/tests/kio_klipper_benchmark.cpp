@@ -0,0 +1,889 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file End to end benchmark of the 'klipper:/' protocol
+ * The driver runs the slave in-process against the mock klipper on a private bus (see TestBus and mock_klipper.cpp).
+ * Commands are dispatched to the slave just like an application would send them, the application side of the
+ * connection to the slave is played by a thread of the driver. The latency of a command is measured from dispatching
+ * it until the application side received its finished() or error(), so the transfer of the results is included.
+ * Usage: kio_klipper_benchmark [--entries N] [--size MIN[:MAX]] [--latency USECS] [--mixed] [--digests] [--rounds N]
+ *                              [--instrumented] [--bulk N] [--slaves N] [--large MB] [--put] [--copy]
+ * - entries, size, latency, mixed and digests are handed to the mock klipper
+ * - rounds:       number of times each command is repeated (default 100)
+ * - instrumented: enables the instrumentation of the slave and prints its report in the end
+ * - bulk:         gets the first N entries one after another, as copying them out of 'klipper:/' does,
+ *                 once served from the history transferred by the listing and once requesting every entry on its own
+ * - large:        gets a text entry of the given size in megabytes, once streamed in chunks and once sent as a whole,
+ *                 and prints the peak of the resident set size each of them adds
+ * - put:          puts entries of 1 KB up to 100 MB, those exceeding the limit of klipper have to be rejected
+ * - copy:         copies the content of files of 10 KB up to 100 MB onto the clipboard, mapped and read in blocks of 1 KB
+ * Classifications cached by former runs are dropped first, so the first listing is always a cold one.
+ * Measure a release build, debug output takes more time than most of the commands.
+ * @see BenchmarkConnection
+ * @author Christian Reiner
+ */
+
+#include <stdio.h>
+#include <QCoreApplication>
+#include <QProcess>
+#include <QDataStream>
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QMutex>
+#include <QSemaphore>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <QWaitCondition>
+#include <QtAlgorithms>
+#include <QtDBus/QDBusInterface>
+#include <kaboutdata.h>
+#include <kcomponentdata.h>
+#include <kshareddatacache.h>
+#include <kstandarddirs.h>
+#include <kurl.h>
+#include <kio/connection.h>
+#include <kio/global.h>
+#include <kio/slaveinterface.h>
+#include <kio/udsentry.h>
+#include "utility/exception.h"
+#include "utility/instrumentation.h"
+#include "protocol/kio_clipboard_protocol.h"
+#include "protocol/kio_klipper_protocol.h"
+#include "tests/test_bus.h"
+
+using namespace KIO;
+using namespace KIO_CLIPBOARD;
+
+// milliseconds to wait for the slave to answer a single command
+static const int C_timeout = 30000;
+
+/*!
+ * class BenchmarkConnection
+ * @brief Application side of the connection to the slave, running in a thread of its own.
+ * A separate thread is required since the slave blocks whilst sending and whilst waiting for data to put.
+ * The thread collects what the slave sends in answer to a command and signals its outcome (finished or error).
+ * @author Christian Reiner
+ */
+class BenchmarkConnection
+  : public QThread
+{
+  private:
+    mutable QMutex       m_mutex;
+    QWaitCondition       m_listening;
+    QSemaphore           m_outcomes;
+    bool                 m_started;
+    bool                 m_stopped;
+    QString              m_address;
+    QByteArray           m_payload;
+    int                  m_offset;
+    InstrumentationClock m_clock;
+    qint64               m_first;
+    qint64               m_bytes;
+    QStringList          m_names;
+    int                  m_outcome;
+    QString              m_error;
+    void handle ( Connection& connection, int command, const QByteArray& data );
+  protected:
+    void run ( );
+  public:
+    BenchmarkConnection ( );
+    QString listen  ( );
+    void    stop    ( );
+    void    prepare ( const QByteArray& payload=QByteArray() );
+    bool    await   ( int timeout );
+    inline int         outcome ( ) const { QMutexLocker _locker ( &m_mutex ); return m_outcome; };
+    inline QString     error   ( ) const { QMutexLocker _locker ( &m_mutex ); return m_error;   };
+    inline qint64      first   ( ) const { QMutexLocker _locker ( &m_mutex ); return m_first;   };
+    inline qint64      bytes   ( ) const { QMutexLocker _locker ( &m_mutex ); return m_bytes;   };
+    inline QStringList names   ( ) const { QMutexLocker _locker ( &m_mutex ); return m_names;   };
+}; // class BenchmarkConnection
+
+/*!
+ * BenchmarkConnection::BenchmarkConnection
+ * @brief Constructor of class BenchmarkConnection
+ * @author Christian Reiner
+ */
+BenchmarkConnection::BenchmarkConnection ( )
+  : QThread   ( )
+  , m_started ( FALSE )
+  , m_stopped ( FALSE )
+  , m_offset  ( 0 )
+  , m_first   ( -1 )
+  , m_bytes   ( 0 )
+  , m_outcome ( 0 )
+{
+} // BenchmarkConnection::BenchmarkConnection
+
+/*!
+ * BenchmarkConnection::listen
+ * @brief Starts the thread and waits for it to listen for the slave.
+ * @return address the slave has to connect to, empty if listening failed
+ * @author Christian Reiner
+ */
+QString BenchmarkConnection::listen ( )
+{
+  start ( );
+  QMutexLocker _locker ( &m_mutex );
+  while ( ! m_started )
+    m_listening.wait ( &m_mutex );
+  return m_address;
+} // BenchmarkConnection::listen
+
+/*!
+ * BenchmarkConnection::stop
+ * @brief Stops the thread and waits for it to end.
+ * @author Christian Reiner
+ */
+void BenchmarkConnection::stop ( )
+{
+  {
+    QMutexLocker _locker ( &m_mutex );
+    m_stopped = TRUE;
+  }
+  wait ( );
+} // BenchmarkConnection::stop
+
+/*!
+ * BenchmarkConnection::prepare
+ * @brief Resets everything collected for the previous command, called right before dispatching a command.
+ * @param payload data handed to the slave when it requests data, that is during put()
+ * @author Christian Reiner
+ */
+void BenchmarkConnection::prepare ( const QByteArray& payload )
+{
+  QMutexLocker _locker ( &m_mutex );
+  m_payload = payload;
+  m_offset  = 0;
+  m_first   = -1;
+  m_bytes   = 0;
+  m_outcome = 0;
+  m_names.clear ( );
+  m_error.clear ( );
+  m_clock.start ( );
+} // BenchmarkConnection::prepare
+
+/*!
+ * BenchmarkConnection::await
+ * @brief Waits for the slave to finish the current command.
+ * @param timeout maximum time to wait in milliseconds
+ * @return true if the slave called finished() or error() in time
+ * @author Christian Reiner
+ */
+bool BenchmarkConnection::await ( int timeout )
+{
+  return m_outcomes.tryAcquire ( 1, timeout );
+} // BenchmarkConnection::await
+
+/*!
+ * BenchmarkConnection::run
+ * @brief Accepts the connection of the slave and handles everything the slave sends until stopped.
+ * @author Christian Reiner
+ */
+void BenchmarkConnection::run ( )
+{
+  ConnectionServer _server;
+  _server.listenForRemote ( );
+  QEventLoop _loop;
+  QObject::connect ( &_server, SIGNAL(newConnection()), &_loop, SLOT(quit()) );
+  QTimer::singleShot ( C_timeout, &_loop, SLOT(quit()) );
+  {
+    QMutexLocker _locker ( &m_mutex );
+    m_started = TRUE;
+    if ( _server.isListening() )
+      m_address = _server.address ( );
+    m_listening.wakeAll ( );
+  }
+  if ( ! _server.isListening() )
+    return;
+  _loop.exec ( );
+  Connection _connection;
+  _server.setNextPendingConnection ( &_connection );
+  while ( _connection.isConnected() )
+  {
+    {
+      QMutexLocker _locker ( &m_mutex );
+      if ( m_stopped )
+        return;
+    }
+    if ( ! _connection.hasTaskAvailable() && ! _connection.waitForIncomingTask(100) )
+      continue;
+    int _command;
+    QByteArray _data;
+    if ( -1!=_connection.read(&_command,_data) )
+      handle ( _connection, _command, _data );
+  }
+} // BenchmarkConnection::run
+
+/*!
+ * BenchmarkConnection::handle
+ * @brief Handles a single message of the slave.
+ * @param connection connection to the slave
+ * @param command message type
+ * @param data message data
+ * @author Christian Reiner
+ */
+void BenchmarkConnection::handle ( Connection& connection, int command, const QByteArray& data )
+{
+  QMutexLocker _locker ( &m_mutex );
+  switch ( command )
+  {
+    case MSG_DATA_REQ:
+      // the payload is handed over in chunks, as a job does, the request following the last one is answered by an empty chunk
+      connection.send ( MSG_DATA, m_payload.mid(m_offset,C_transferChunkLength) );
+      m_offset = qMin ( m_offset+C_transferChunkLength, m_payload.size() );
+      break;
+    case MSG_DATA:
+      m_bytes += data.size ( );
+      break;
+    case MSG_LIST_ENTRIES:
+    {
+      if ( -1==m_first )
+        m_first = elapsedUsecs ( m_clock );
+      QDataStream _stream ( data );
+      quint32 _count;
+      _stream >> _count;
+      for ( quint32 _position=0; _position<_count; _position++ )
+      {
+        UDSEntry _entry;
+        _stream >> _entry;
+        m_names << _entry.stringValue ( UDSEntry::UDS_NAME );
+      }
+      m_bytes += data.size ( );
+      break;
+    }
+    case MSG_ERROR:
+    {
+      QDataStream _stream ( data );
+      qint32 _code;
+      QString _text;
+      _stream >> _code >> _text;
+      m_error   = QString ( "error %1: %2" ).arg(_code).arg(_text);
+      m_outcome = MSG_ERROR;
+      m_outcomes.release ( );
+      break;
+    }
+    case MSG_FINISHED:
+      m_outcome = MSG_FINISHED;
+      m_outcomes.release ( );
+      break;
+    default:
+      break;
+  }
+} // BenchmarkConnection::handle
+
+/*!
+ * class BenchmarkProtocol
+ * @brief The slave under test, able to serve get() the way it was done before the history was kept by the frontend.
+ * Back then every get() requested its entry from the clipboard, one round trip for each entry.
+ * Besides that it serves a large entry held by itself under the name "large", streamed or sent as a whole as before.
+ * An entry of some hundred megabytes exceeds the maximum size of a dbus message, klipper could not hand it over.
+ * Finally it copies the content of a file onto the clipboard, mapping the file or reading it in blocks of 1 KB as before.
+ * Copying files larger than the limit of the clipboard requires a confirmation, so this is offered without a command.
+ * @author Christian Reiner
+ */
+class BenchmarkProtocol
+  : public KIOKlipperProtocol
+{
+  private:
+    bool    m_itemwise;
+    QString m_large;
+    bool    m_whole;
+  public:
+    inline BenchmarkProtocol ( const QByteArray& app ) : KIOKlipperProtocol ( QByteArray(), app ), m_itemwise ( FALSE ), m_whole ( FALSE ) { };
+    inline void setItemwise ( bool itemwise ) { m_itemwise = itemwise; };
+    inline void setLarge    ( const QString& payload, bool whole ) { m_large = payload; m_whole = whole; };
+    void get ( const KUrl& url );
+    inline void copyContent ( const KUrl& url ) { copyFromFile_Content ( url ); };
+    void copyContentBlockwise ( const KUrl& url );
+}; // class BenchmarkProtocol
+
+/*!
+ * BenchmarkProtocol::get
+ * @brief Delivers an entry, requesting it from the clipboard if told to do so by setItemwise().
+ * @param url url of the entry
+ * @author Christian Reiner
+ */
+void BenchmarkProtocol::get ( const KUrl& url )
+{
+  if ( "large"==url.fileName() )
+  {
+    mimeType ( "text/plain" );
+    if ( m_whole )
+    {
+      data ( m_large.toUtf8() );
+      data ( QByteArray() );
+    }
+    else
+      sendContent ( m_large );
+    finished ( );
+    return;
+  }
+  if ( ! m_itemwise )
+  {
+    KIOKlipperProtocol::get ( url );
+    return;
+  }
+  try
+  {
+    const NodeWrapper* _entry = m_clipboard->findNodeByUrl ( url );
+    switch ( _entry->semantics() )
+    {
+      case KIO_CLIPBOARD::NodeWrapper::S_EMPTY:
+      case KIO_CLIPBOARD::NodeWrapper::S_TEXT:
+      case KIO_CLIPBOARD::NodeWrapper::S_CODE:
+        mimeType    ( _entry->mimetype()->name() );
+        sendContent ( m_clipboard->getClipboardEntry(_entry->index()) );
+        finished    ( );
+        return;
+      default:
+        // redirections are not affected
+        KIOKlipperProtocol::get ( url );
+    }
+  }
+  catch ( Exception &e ) { error( e.getCode(), e.getText() ); }
+} // BenchmarkProtocol::get
+
+/*!
+ * BenchmarkProtocol::copyContentBlockwise
+ * @brief Copies the content of a file onto the clipboard the way it was done before it was mapped.
+ * @param url url of the file
+ * @author Christian Reiner
+ */
+void BenchmarkProtocol::copyContentBlockwise ( const KUrl& url )
+{
+  QByteArray _payload, _buffer;
+  QFile _file ( url.path() );
+  if ( ! _file.open(QIODevice::ReadOnly) )
+    throw Exception ( Error(ERR_COULD_NOT_READ), url.prettyUrl() );
+  do
+  {
+    _buffer   = _file.read ( 1024 );
+    _payload += _buffer;
+  } while ( ! _file.atEnd() && _buffer!=QByteArray() );
+  _file.close();
+  m_clipboard->pushEntry ( QString(_payload) );
+} // BenchmarkProtocol::copyContentBlockwise
+
+/*!
+ * struct Samples
+ * @brief Latencies of a single kind of command, in microseconds.
+ * @author Christian Reiner
+ */
+struct Samples
+{
+  QString         operation;
+  QVector<qint64> usecs;
+  qint64          bytes;
+  int             errors;
+  QString         error;
+  inline Samples ( const QString& name ) : operation ( name ), bytes ( 0 ), errors ( 0 ) { };
+  void report ( ) const;
+}; // struct Samples
+
+/*!
+ * Samples::report
+ * @brief Prints count, throughput and latency percentiles of the samples.
+ * @author Christian Reiner
+ */
+void Samples::report ( ) const
+{
+  QVector<qint64> _sorted ( usecs );
+  qSort ( _sorted );
+  qint64 _total = 0;
+  foreach ( qint64 _usecs, _sorted )
+    _total += _usecs;
+  const int _count = _sorted.size ( );
+  #define PERCENTILE(p) ( _count ? _sorted.at(qMax(0,(_count*(p)+99)/100-1)) : 0 )
+  printf ( "  %-20s %8d %6d %12.1f %10.1f %8.2f %10lld %10lld %10lld %10lld\n",
+           qPrintable(operation), _count, errors, _total/1000.0,
+           _total ? _count*1000000.0/_total : 0.0, _total ? bytes/double(_total) : 0.0,
+           PERCENTILE(50), PERCENTILE(90), PERCENTILE(99), _count ? _sorted.last() : 0 );
+  #undef PERCENTILE
+  if ( errors )
+    printf ( "    last failure: %s\n", qPrintable(error) );
+} // Samples::report
+
+/*!
+ * option
+ * @brief Value of a command line option.
+ * @param arguments command line arguments
+ * @param name name of the option, for example "--rounds"
+ * @param fallback value used if the option is not given
+ * @return value following the option name
+ * @author Christian Reiner
+ */
+static QString option ( const QStringList& arguments, const QString& name, const QString& fallback )
+{
+  const int _position = arguments.indexOf ( name );
+  return ( -1==_position || _position+1>=arguments.size() ) ? fallback : arguments.at ( _position+1 );
+} // option
+
+/*!
+ * payload
+ * @brief Generates content to be put onto the clipboard.
+ * @param round number of the round, each round generates unique content
+ * @param size size of the content in characters
+ * @return content
+ * @author Christian Reiner
+ */
+static QByteArray payload ( int round, int size )
+{
+  QByteArray _payload = QString("benchmark %1:").arg(round).toUtf8 ( );
+  while ( _payload.size()<size )
+    _payload.append ( " Pack my box with five dozen liquor jugs." );
+  return _payload.left ( qMax(size,_payload.indexOf(':')+1) );
+} // payload
+
+/*!
+ * dispatch
+ * @brief Hands a command to the slave and waits for its outcome.
+ * @param slave slave the command is dispatched to
+ * @param connection application side of the connection to the slave
+ * @param samples samples the latency is recorded in
+ * @param command command, for example CMD_LISTDIR
+ * @param arguments arguments of the command, serialized as an application does
+ * @param data data handed to the slave on request
+ * @return true if the slave finished the command successfully
+ * @author Christian Reiner
+ */
+static bool dispatch ( BenchmarkProtocol* slave, BenchmarkConnection& connection, Samples& samples,
+                       int command, const QByteArray& arguments, const QByteArray& data=QByteArray() )
+{
+  connection.prepare ( data );
+  InstrumentationClock _clock;
+  _clock.start ( );
+  slave->dispatch ( command, arguments );
+  const bool _answered = connection.await ( C_timeout );
+  samples.usecs << elapsedUsecs ( _clock );
+  samples.bytes += connection.bytes() + data.size();
+  if ( _answered && MSG_FINISHED==connection.outcome() )
+    return TRUE;
+  ++samples.errors;
+  samples.error = _answered ? connection.error() : QString("no answer within %1 ms").arg(C_timeout);
+  return FALSE;
+} // dispatch
+
+/*!
+ * arguments
+ * @brief Serializes the arguments of a command taking a single url, like stat, get and listDir.
+ * @param url url
+ * @return serialized arguments
+ * @author Christian Reiner
+ */
+static QByteArray arguments ( const KUrl& url )
+{
+  QByteArray _data;
+  QDataStream _stream ( &_data, QIODevice::WriteOnly );
+  _stream << url;
+  return _data;
+} // arguments
+
+/*!
+ * memory
+ * @brief Memory usage of this process as reported by the kernel.
+ * @return peak and current resident set size, the latter split into anonymous, file backed and shared memory
+ * @author Christian Reiner
+ */
+static QString memory ( )
+{
+  QFile _file ( "/proc/self/status" );
+  if ( ! _file.open(QIODevice::ReadOnly) )
+    return QString ( "unknown" );
+  QStringList _fields;
+  foreach ( const QByteArray& _line, _file.readAll().split('\n') )
+    if ( _line.startsWith("VmHWM:") || _line.startsWith("VmRSS:") || _line.startsWith("Rss") )
+      _fields << QString::fromLatin1(_line).simplified ( );
+  return _fields.join ( ", " );
+} // memory
+
+/*!
+ * copied
+ * @brief Copies the content of a file onto the clipboard, pushing the entry into klipper is included.
+ * @param slave slave copying the content
+ * @param samples samples the latency is recorded in
+ * @param path path of the file
+ * @param blockwise read the file in blocks of 1 KB instead of mapping it
+ * @author Christian Reiner
+ */
+static void copied ( BenchmarkProtocol* slave, Samples& samples, const QString& path, bool blockwise )
+{
+  InstrumentationClock _clock;
+  _clock.start ( );
+  try
+  {
+    if ( blockwise )
+      slave->copyContentBlockwise ( KUrl(path) );
+    else
+      slave->copyContent ( KUrl(path) );
+    samples.bytes += QFile(path).size ( );
+  }
+  catch ( Exception &e )
+  {
+    ++samples.errors;
+    samples.error = e.getText ( );
+  }
+  samples.usecs << elapsedUsecs ( _clock );
+} // copied
+
+/*!
+ * resident
+ * @brief A single figure of the memory usage of this process.
+ * @param field name of the figure, for example "VmHWM:"
+ * @return figure in kilobytes, -1 if unknown
+ * @author Christian Reiner
+ */
+static qint64 resident ( const char* field )
+{
+  QFile _file ( "/proc/self/status" );
+  if ( _file.open(QIODevice::ReadOnly) )
+    foreach ( const QByteArray& _line, _file.readAll().split('\n') )
+      if ( _line.startsWith(field) )
+        return _line.mid(qstrlen(field)).simplified().split(' ').first().toLongLong ( );
+  return -1;
+} // resident
+
+/*!
+ * peak
+ * @brief Gets the large entry and measures the peak of the resident set size it adds.
+ * @param slave slave serving the entry
+ * @param connection application side of the connection to the slave
+ * @param samples samples the latency is recorded in
+ * @return peak in kilobytes above the resident set size before the request, -1 if unknown
+ * The peak is reset before, this requires Linux 4.0 at least.
+ * @author Christian Reiner
+ */
+static qint64 peak ( BenchmarkProtocol* slave, BenchmarkConnection& connection, Samples& samples )
+{
+  QFile _refs ( "/proc/self/clear_refs" );
+  if ( ! _refs.open(QIODevice::WriteOnly) || 1!=_refs.write("5") )
+    return -1;
+  _refs.close ( );
+  const qint64 _before = resident ( "VmRSS:" );
+  dispatch ( slave, connection, samples, CMD_GET, arguments(KUrl("klipper:/large")) );
+  return resident("VmHWM:") - _before;
+} // peak
+
+/*!
+ * slaves
+ * @brief Runs the benchmark in separate processes, first a single one, then several ones concurrently.
+ * @param arguments command line arguments of this process, they are handed on to the slaves
+ * @param count number of concurrent slaves
+ * @return number of slaves that failed
+ * The slaves attach to the bus and the mock klipper started by this process.
+ * Their reports are printed once each of them has finished, so they do not get mixed up.
+ * @author Christian Reiner
+ */
+static int slaves ( const QStringList& arguments, int count )
+{
+  QStringList _arguments = arguments.mid ( 1 );
+  _arguments.removeAt ( _arguments.indexOf("--slaves")+1 );
+  _arguments.removeAll ( "--slaves" );
+  _arguments << "--attach";
+  int _failed = 0;
+  // the first slave lists a cold history, the concurrent ones find what it has classified
+  QList<int> _batches;
+  _batches << 1 << count;
+  foreach ( int _batch, _batches )
+  {
+    QList<QProcess*> _processes;
+    for ( int _slave=0; _slave<_batch; _slave++ )
+    {
+      QProcess* _process = new QProcess;
+      _process->setProcessChannelMode ( QProcess::MergedChannels );
+      _process->start ( QCoreApplication::applicationFilePath(), _arguments );
+      _processes << _process;
+    }
+    foreach ( QProcess* _process, _processes )
+    {
+      if ( ! _process->waitForFinished(-1) || 0!=_process->exitCode() )
+        ++_failed;
+      printf ( "# slave %d of %d\n%s", _processes.indexOf(_process)+1, _processes.size(),
+               _process->readAll().constData() );
+      delete _process;
+    }
+  }
+  return _failed;
+} // slaves
+
+int main ( int argc, char** argv )
+{
+  KAboutData _about ( "kio_klipper_benchmark", 0, ki18n("kio_klipper_benchmark"), "1.0" );
+  KComponentData _component ( _about );
+  QCoreApplication _app ( argc, argv );
+  const QStringList _arguments = _app.arguments ( );
+  const int     _rounds  = qMax ( 1, option(_arguments,"--rounds","100").toInt() );
+  const QString _entries = option ( _arguments, "--entries", "1000" );
+  const QString _size    = option ( _arguments, "--size", "256" );
+  const QString _latency = option ( _arguments, "--latency", "0" );
+  // the environment is read once, on the first instrumented operation
+  if ( _arguments.contains("--instrumented") )
+    qputenv ( "KIO_CLIPBOARD_INSTRUMENTATION", "1" );
+
+  // slaves started by this process attach to its bus and mock klipper
+  const bool _attached = _arguments.contains ( "--attach" );
+  TestBus _bus;
+  if ( ! _attached )
+  {
+    if ( ! _bus.start() )
+    {
+      fprintf ( stderr, "failed to start a private dbus-daemon\n" );
+      return 2;
+    }
+    QStringList _mock;
+    _mock << "--entries" << _entries << "--size" << _size << "--latency" << _latency;
+    if ( _arguments.contains("--mixed") )
+      _mock << "--mixed";
+    if ( _arguments.contains("--digests") )
+      _mock << "--digests";
+    if ( ! _bus.startKlipper(_mock) )
+    {
+      fprintf ( stderr, "failed to start the mock klipper\n" );
+      return 2;
+    }
+    // classifications cached or published by former runs would turn the first listing into a warm one
+    KSharedDataCache::deleteCache ( "kio-clipboard-klipper" );
+    QFile::remove ( KStandardDirs::locateLocal("tmp","kio-clipboard-klipper.nodes") );
+    const int _slaves = option ( _arguments, "--slaves", "0" ).toInt ( );
+    if ( 0<_slaves )
+      return slaves ( _arguments, _slaves ) ? 1 : 0;
+  }
+
+  BenchmarkConnection _connection;
+  const QString _address = _connection.listen ( );
+  if ( _address.isEmpty() )
+  {
+    fprintf ( stderr, "failed to listen for the slave\n" );
+    return 2;
+  }
+  Samples _setup ( "setup" );
+  InstrumentationClock _clock;
+  _clock.start ( );
+  BenchmarkProtocol* _slave = new BenchmarkProtocol ( _address.toLocal8Bit() );
+  _setup.usecs << elapsedUsecs ( _clock );
+  // the slave reports failures of its setup right away, there is no command to wait for
+  if ( _connection.await(200) )
+  {
+    fprintf ( stderr, "failed to set up the slave: %s\n", qPrintable(_connection.error()) );
+    return 1;
+  }
+
+  const KUrl _root ( "klipper:/" );
+  QList<Samples> _results;
+
+  // the first listing classifies all entries, later ones reuse the nodes
+  Samples _cold ( "listDir.cold" ), _coldFirst ( "listDir.cold.first" );
+  dispatch ( _slave, _connection, _cold, CMD_LISTDIR, arguments(_root) );
+  _coldFirst.usecs << _connection.first ( );
+  const QStringList _names = _connection.names ( );
+  if ( _names.size()!=_entries.toInt() )
+  {
+    ++_cold.errors;
+    _cold.error = QString ( "listed %1 of %2 entries" ).arg(_names.size()).arg(_entries);
+  }
+  _results << _setup << _cold << _coldFirst;
+
+  Samples _list ( "listDir" ), _listFirst ( "listDir.first" );
+  for ( int _round=0; _round<_rounds; _round++ )
+  {
+    dispatch ( _slave, _connection, _list, CMD_LISTDIR, arguments(_root) );
+    _listFirst.usecs << _connection.first ( );
+  }
+  _results << _list << _listFirst;
+
+  if ( ! _names.isEmpty() )
+  {
+    Samples _stat ( "stat" );
+    for ( int _round=0; _round<_rounds; _round++ )
+    {
+      KUrl _url ( _root );
+      _url.addPath ( _names.at(_round%_names.size()) );
+      dispatch ( _slave, _connection, _stat, CMD_STAT, arguments(_url) );
+    }
+    Samples _get ( "get" );
+    for ( int _round=0; _round<_rounds; _round++ )
+    {
+      KUrl _url ( _root );
+      _url.addPath ( _names.at(_round%_names.size()) );
+      dispatch ( _slave, _connection, _get, CMD_GET, arguments(_url) );
+    }
+    _results << _stat << _get;
+  }
+
+  // a bulk copy out of the clipboard, each entry is fetched once
+  const int _bulk = qMin ( _names.size(), option(_arguments,"--bulk","0").toInt() );
+  if ( 0<_bulk )
+  {
+    Samples _snapshot ( "get.bulk" ), _itemwise ( "get.bulk.itemwise" );
+    for ( int _entry=0; _entry<_bulk; _entry++ )
+    {
+      KUrl _url ( _root );
+      _url.addPath ( _names.at(_entry) );
+      dispatch ( _slave, _connection, _snapshot, CMD_GET, arguments(_url) );
+    }
+    _slave->setItemwise ( TRUE );
+    for ( int _entry=0; _entry<_bulk; _entry++ )
+    {
+      KUrl _url ( _root );
+      _url.addPath ( _names.at(_entry) );
+      dispatch ( _slave, _connection, _itemwise, CMD_GET, arguments(_url) );
+    }
+    _slave->setItemwise ( FALSE );
+    _results << _snapshot << _itemwise;
+  }
+
+  // a large entry, streamed and sent as a whole
+  const int _large = option(_arguments,"--large","0").toInt ( );
+  QStringList _peaks;
+  if ( 0<_large )
+  {
+    Samples _streamed ( "get.large" ), _whole ( "get.large.whole" );
+    const QString _payload = QString("Pack my box with five dozen liquor jugs. ").repeated((_large<<20)/41+1).left ( _large<<20 );
+    _slave->setLarge ( _payload, FALSE );
+    _peaks << QString ( "get.large %1 kB" ).arg ( peak(_slave,_connection,_streamed) );
+    _slave->setLarge ( _payload, TRUE );
+    _peaks << QString ( "get.large.whole %1 kB" ).arg ( peak(_slave,_connection,_whole) );
+    _slave->setLarge ( QString(), FALSE );
+    if ( _streamed.bytes!=qint64(_large)<<20 || _whole.bytes!=qint64(_large)<<20 )
+    {
+      ++_streamed.errors;
+      _streamed.error = QString ( "received %1 and %2 of %3 bytes" ).arg(_streamed.bytes).arg(_whole.bytes).arg(qint64(_large)<<20);
+    }
+    _results << _streamed << _whole;
+  }
+
+  // each put and copy changes the history, so the slave has to refresh afterwards
+  // slaves running concurrently only read, so they all see the same history
+  if ( ! _attached )
+  {
+    const int _payloadSize = _size.split(':').first().toInt ( );
+    Samples _put ( "put" );
+    for ( int _round=0; _round<_rounds; _round++ )
+    {
+      KUrl _url ( _root );
+      _url.addPath ( QString("put-%1.txt").arg(_round) );
+      QByteArray _data;
+      QDataStream _stream ( &_data, QIODevice::WriteOnly );
+      _stream << _url << qint8(1) << qint8(0) << int(-1);
+      dispatch ( _slave, _connection, _put, CMD_PUT, _data, payload(_round,_payloadSize) );
+    }
+    _results << _put;
+
+    // entries of growing size, klipper only accepts the smaller ones, the larger ones are rejected as they arrive
+    // the data rate of a rejected entry is the one of the payload offered, only the data up to the limit is read
+    if ( _arguments.contains("--put") )
+    {
+      const int _sizes[] = { 1<<10, 32<<10, 1<<20, 100<<20 };
+      const char* const _names[] = { "put.1KB", "put.32KB", "put.1MB", "put.100MB" };
+      for ( unsigned int _size=0; _size<sizeof(_sizes)/sizeof(int); _size++ )
+      {
+        Samples _sized ( _names[_size] );
+        const bool _accepted = ( _sizes[_size]<=32<<10 );
+        for ( int _round=0; _round<qMin(_rounds,10); _round++ )
+        {
+          KUrl _url ( _root );
+          _url.addPath ( QString("put-%1-%2.txt").arg(_sizes[_size]).arg(_round) );
+          QByteArray _data;
+          QDataStream _stream ( &_data, QIODevice::WriteOnly );
+          _stream << _url << qint8(1) << qint8(0) << int(-1);
+          const bool _finished = dispatch ( _slave, _connection, _sized, CMD_PUT, _data, payload(3*_rounds+_round,_sizes[_size]) );
+          // above the limit a rejection is what is expected, accepting the entry is the failure
+          if ( _accepted )
+            continue;
+          if ( _finished )
+          {
+            ++_sized.errors;
+            _sized.error = QString ( "accepted beyond the limit of klipper" );
+          }
+          else if ( MSG_ERROR==_connection.outcome() )
+            --_sized.errors;
+        }
+        _results << _sized;
+      }
+    }
+
+    Samples _copy ( "copy" );
+    const QString _path = QDir::temp().filePath ( QString("kio_klipper_benchmark-%1.txt").arg(QCoreApplication::applicationPid()) );
+    for ( int _round=0; _round<_rounds; _round++ )
+    {
+      QFile _file ( _path );
+      if ( ! _file.open(QIODevice::WriteOnly|QIODevice::Truncate) || -1==_file.write(payload(_rounds+_round,_payloadSize)) )
+      {
+        fprintf ( stderr, "failed to write %s\n", qPrintable(_path) );
+        return 2;
+      }
+      _file.close ( );
+      QByteArray _data;
+      QDataStream _stream ( &_data, QIODevice::WriteOnly );
+      _stream << KUrl(_path) << _root << int(-1) << qint8(1);
+      dispatch ( _slave, _connection, _copy, CMD_COPY, _data );
+    }
+    _results << _copy;
+
+    // files of growing size, mapped against read in blocks of 1 KB
+    if ( _arguments.contains("--copy") )
+    {
+      const int _sizes[] = { 10<<10, 1<<20, 10<<20, 100<<20 };
+      const char* const _names[] = { "10KB", "1MB", "10MB", "100MB" };
+      for ( unsigned int _size=0; _size<sizeof(_sizes)/sizeof(int); _size++ )
+      {
+        QFile _file ( _path );
+        if ( ! _file.open(QIODevice::WriteOnly|QIODevice::Truncate) || -1==_file.write(payload(_size,_sizes[_size])) )
+        {
+          fprintf ( stderr, "failed to write %s\n", qPrintable(_path) );
+          return 2;
+        }
+        _file.close ( );
+        Samples _mapped ( QString("copy.%1").arg(_names[_size]) ), _blockwise ( QString("copy.%1.blockwise").arg(_names[_size]) );
+        for ( int _round=0; _round<qMin(_rounds,5); _round++ )
+        {
+          copied ( _slave, _mapped,    _path, FALSE );
+          copied ( _slave, _blockwise, _path, TRUE );
+        }
+        _results << _mapped << _blockwise;
+      }
+    }
+    QFile::remove ( _path );
+
+    // a single new entry per listing, as when someone copies something whilst a view shows the clipboard
+    Samples _changed ( "listDir.changed" );
+    QDBusInterface _klipper ( "org.kde.klipper", "/klipper", "org.kde.klipper.klipper" );
+    for ( int _round=0; _round<_rounds; _round++ )
+    {
+      _klipper.call ( "setClipboardContents", QString::fromUtf8(payload(2*_rounds+_round,_payloadSize)) );
+      dispatch ( _slave, _connection, _changed, CMD_LISTDIR, arguments(_root) );
+    }
+    _results << _changed;
+  }
+
+  // taken whilst the slave is still alive
+  const QString _memory = memory ( );
+  delete _slave;
+  _connection.stop ( );
+
+  int _errors = 0;
+  printf ( "# kio_klipper_benchmark: %s entries of %s characters, %s us latency%s%s, %d rounds\n",
+           qPrintable(_entries), qPrintable(_size), qPrintable(_latency),
+           _arguments.contains("--mixed") ? ", mixed content" : "", _arguments.contains("--digests") ? ", digests" : "", _rounds );
+  printf ( "# %-20s %8s %6s %12s %10s %8s %10s %10s %10s %10s\n",
+           "operation", "count", "errors", "total[ms]", "ops/s", "MB/s", "p50[us]", "p90[us]", "p99[us]", "max[us]" );
+  foreach ( const Samples& _samples, _results )
+  {
+    _samples.report ( );
+    _errors += _samples.errors;
+  }
+  printf ( "# memory: %s\n", qPrintable(_memory) );
+  if ( ! _peaks.isEmpty() )
+    printf ( "# peak resident set size added: %s\n", qPrintable(_peaks.join(", ")) );
+  if ( isInstrumented() )
+    printf ( "%s", qPrintable(Instrumentation::instance().report()) );
+  return _errors ? 1 : 0;
+} // main
@@ -0,0 +1,412 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Benchmark of class KlipperBackend against the mock klipper
+ * @see KlipperBackendBenchmark
+ * @author Christian Reiner
+ */
+
+#include <QtTest>
+#include <QStringList>
+#include <QtDBus/QDBusInterface>
+#include <QtDBus/QDBusPendingCall>
+#include <QtDBus/QDBusServiceWatcher>
+#include <qtest_kde.h>
+#include "client/dbus/dbus_registry.h"
+#include "clipboard/klipper/klipper_backend.h"
+#include "tests/test_bus.h"
+
+using namespace KIO_CLIPBOARD;
+
+/*!
+ * class KlipperBackendBenchmark
+ * @brief Measures restoring a history of 100 and 1000 entries into klipper, as deleting an entry does.
+ * The pipelined restore of setClipboardHistory() is compared with one concluded request per entry,
+ * which is what restoring cost before, and with restoring a history klipper already holds.
+ * Besides that the startup of a backend is measured: a proxy shared by the registry against a fresh proxy
+ * introspecting klipper, which is what each frontend and slave used to construct.
+ * Listing the history as digests is compared with listing it completely, for small and for large entries.
+ * The latency of fetching 100 entries is measured, all requests in flight at once against one request after the other.
+ * Finally the overhead per call of the typed proxy is compared with the generic call converting variants,
+ * which is what the backend used before, and with a proxy introspecting klipper, each for 1000 calls in a row.
+ * The mock klipper runs on a private bus, it is restarted whenever a row asks for a different latency or entry size.
+ * It always offers digests, that does not change anything else.
+ * @author Christian Reiner
+ */
+class KlipperBackendBenchmark
+  : public QObject
+{
+  Q_OBJECT
+  private:
+    enum { C_capacity = 2000, C_fetched = 100, C_calls = 1000 };
+    TestBus m_bus;
+    int     m_latency;
+    QString m_size;
+    void klipper ( int latency, const QString& size="256" );
+    static QStringList history ( int count );
+    static void rows ( );
+    static void latencies ( );
+    static void sizes ( );
+  private slots:
+    void initTestCase     ( );
+    void cleanupTestCase  ( );
+    void restore_data     ( );
+    void restore          ( );
+    void sequential_data  ( );
+    void sequential       ( );
+    void unchanged_data   ( );
+    void unchanged        ( );
+    void startupIntrospected_data ( );
+    void startupIntrospected      ( );
+    void startupShared_data       ( );
+    void startupShared            ( );
+    void listFull_data            ( );
+    void listFull                 ( );
+    void listDigests_data         ( );
+    void listDigests              ( );
+    void fetchedOneByOne_data     ( );
+    void fetchedOneByOne          ( );
+    void fetchedInFlight_data     ( );
+    void fetchedInFlight          ( );
+    void perCall_data             ( );
+    void perCall                  ( );
+}; // class KlipperBackendBenchmark
+
+/*!
+ * KlipperBackendBenchmark::klipper
+ * @brief Makes sure the mock klipper answers with the given latency, its history can hold all entries restored.
+ * @param latency delay of each call in microseconds
+ * @param size size of the entries the history is filled with initially, as handed to the mock
+ * @author Christian Reiner
+ */
+void KlipperBackendBenchmark::klipper ( int latency, const QString& size )
+{
+  if ( latency==m_latency && size==m_size )
+    return;
+  QVERIFY ( m_bus.startKlipper(QStringList() << "--entries" << QString::number(C_capacity) << "--size" << size
+                                             << "--latency" << QString::number(latency) << "--mixed" << "--digests") );
+  m_latency = latency;
+  m_size    = size;
+} // KlipperBackendBenchmark::klipper
+
+/*!
+ * KlipperBackendBenchmark::history
+ * @brief A history to be restored, oldest entry first.
+ * @param count number of entries
+ * @return unique entries
+ * @author Christian Reiner
+ */
+QStringList KlipperBackendBenchmark::history ( int count )
+{
+  QStringList _history;
+  for ( int _index=0; _index<count; _index++ )
+    _history << QString ( "restored entry %1: The quick brown fox jumps over the lazy dog." ).arg ( _index );
+  return _history;
+} // KlipperBackendBenchmark::history
+
+/*!
+ * KlipperBackendBenchmark::rows
+ * @brief Rows shared by all benchmarks: size of the history and latency of klipper.
+ * @author Christian Reiner
+ */
+void KlipperBackendBenchmark::rows ( )
+{
+  QTest::addColumn<int> ( "entries" );
+  QTest::addColumn<int> ( "latency" );
+  QTest::newRow ( "100 entries" )                   << 100  << 0;
+  QTest::newRow ( "1000 entries" )                  << 1000 << 0;
+  QTest::newRow ( "100 entries, 200 us latency" )   << 100  << 200;
+  QTest::newRow ( "1000 entries, 200 us latency" )  << 1000 << 200;
+} // KlipperBackendBenchmark::rows
+
+/*!
+ * KlipperBackendBenchmark::latencies
+ * @brief Rows of the startup benchmarks: latency of klipper.
+ * @author Christian Reiner
+ */
+void KlipperBackendBenchmark::latencies ( )
+{
+  QTest::addColumn<int> ( "latency" );
+  QTest::newRow ( "no latency" )     << 0;
+  QTest::newRow ( "200 us latency" ) << 200;
+} // KlipperBackendBenchmark::latencies
+
+/*!
+ * KlipperBackendBenchmark::sizes
+ * @brief Rows of the listing benchmarks: size of the entries held by klipper.
+ * @author Christian Reiner
+ */
+void KlipperBackendBenchmark::sizes ( )
+{
+  QTest::addColumn<QString> ( "size" );
+  QTest::newRow ( "256 characters" )         << QString ( "256" );
+  QTest::newRow ( "4096 to 8192 characters" ) << QString ( "4096:8192" );
+} // KlipperBackendBenchmark::sizes
+
+/*!
+ * KlipperBackendBenchmark::initTestCase
+ * @brief Starts the private bus.
+ * @author Christian Reiner
+ */
+void KlipperBackendBenchmark::initTestCase ( )
+{
+  m_latency = -1;
+  QVERIFY ( m_bus.start() );
+} // KlipperBackendBenchmark::initTestCase
+
+/*!
+ * KlipperBackendBenchmark::cleanupTestCase
+ * @brief Checks that klipper, restarted for each latency, is still watched by a single watcher only.
+ * @author Christian Reiner
+ */
+void KlipperBackendBenchmark::cleanupTestCase ( )
+{
+  QCOMPARE ( DBusRegistry::instance().findChildren<QDBusServiceWatcher*>().size(), 1 );
+} // KlipperBackendBenchmark::cleanupTestCase
+
+void KlipperBackendBenchmark::restore_data ( )    { rows(); }
+void KlipperBackendBenchmark::sequential_data ( ) { rows(); }
+void KlipperBackendBenchmark::unchanged_data ( )  { rows(); }
+void KlipperBackendBenchmark::startupIntrospected_data ( ) { latencies(); }
+void KlipperBackendBenchmark::startupShared_data ( )       { latencies(); }
+void KlipperBackendBenchmark::listFull_data ( )            { sizes(); }
+void KlipperBackendBenchmark::listDigests_data ( )         { sizes(); }
+void KlipperBackendBenchmark::fetchedOneByOne_data ( )     { latencies(); }
+void KlipperBackendBenchmark::fetchedInFlight_data ( )     { latencies(); }
+
+/*!
+ * KlipperBackendBenchmark::restore
+ * @brief Restores the history into an emptied klipper, with a window of requests in flight.
+ * @author Christian Reiner
+ */
+void KlipperBackendBenchmark::restore ( )
+{
+  QFETCH ( int, entries );
+  QFETCH ( int, latency );
+  klipper ( latency );
+  const QStringList _history = history ( entries );
+  KlipperBackend _backend;
+  QBENCHMARK
+  {
+    _backend.clearClipboardHistory ( );
+    _backend.setClipboardHistory ( _history );
+  }
+  QCOMPARE ( _backend.getClipboardHistoryMenu().size(), entries );
+  QCOMPARE ( _backend.getClipboardHistoryMenu().first(), _history.last() );
+} // KlipperBackendBenchmark::restore
+
+/*!
+ * KlipperBackendBenchmark::sequential
+ * @brief Restores the history into an emptied klipper, waiting for each request before sending the next one.
+ * @author Christian Reiner
+ */
+void KlipperBackendBenchmark::sequential ( )
+{
+  QFETCH ( int, entries );
+  QFETCH ( int, latency );
+  klipper ( latency );
+  const QStringList _history = history ( entries );
+  KlipperBackend _backend;
+  QBENCHMARK
+  {
+    _backend.clearClipboardHistory ( );
+    foreach ( const QString& _entry, _history )
+      _backend.setClipboardContents ( _entry );
+  }
+  QCOMPARE ( _backend.getClipboardHistoryMenu().size(), entries );
+} // KlipperBackendBenchmark::sequential
+
+/*!
+ * KlipperBackendBenchmark::unchanged
+ * @brief Restores the history klipper holds already, only the history is read in that case.
+ * @author Christian Reiner
+ */
+void KlipperBackendBenchmark::unchanged ( )
+{
+  QFETCH ( int, entries );
+  QFETCH ( int, latency );
+  klipper ( latency );
+  const QStringList _history = history ( entries );
+  KlipperBackend _backend;
+  _backend.clearClipboardHistory ( );
+  _backend.setClipboardHistory ( _history );
+  QBENCHMARK
+  {
+    _backend.setClipboardHistory ( _history );
+  }
+  QCOMPARE ( _backend.getClipboardHistoryMenu().size(), entries );
+} // KlipperBackendBenchmark::unchanged
+
+/*!
+ * KlipperBackendBenchmark::startupIntrospected
+ * @brief Constructs a proxy and sends the first request, the construction introspects klipper.
+ * @author Christian Reiner
+ */
+void KlipperBackendBenchmark::startupIntrospected ( )
+{
+  QFETCH ( int, latency );
+  klipper ( latency );
+  QBENCHMARK
+  {
+    QDBusInterface _klipper ( "org.kde.klipper", "/klipper", "org.kde.klipper.klipper" );
+    QVERIFY ( _klipper.call("getClipboardContents").errorMessage().isEmpty() );
+  }
+} // KlipperBackendBenchmark::startupIntrospected
+
+/*!
+ * KlipperBackendBenchmark::startupShared
+ * @brief Constructs a backend and sends the first request through the proxy shared by the registry.
+ * @author Christian Reiner
+ */
+void KlipperBackendBenchmark::startupShared ( )
+{
+  QFETCH ( int, latency );
+  klipper ( latency );
+  QBENCHMARK
+  {
+    KlipperBackend _backend;
+    _backend.getClipboardContents ( );
+  }
+} // KlipperBackendBenchmark::startupShared
+
+/*!
+ * KlipperBackendBenchmark::listFull
+ * @brief Lists the complete history, payloads included.
+ * @author Christian Reiner
+ */
+void KlipperBackendBenchmark::listFull ( )
+{
+  QFETCH ( QString, size );
+  klipper ( 0, size );
+  KlipperBackend _backend;
+  int _entries = 0;
+  QBENCHMARK
+  {
+    _entries = _backend.getClipboardHistoryMenu().size ( );
+  }
+  QCOMPARE ( _entries, int(C_capacity) );
+} // KlipperBackendBenchmark::listFull
+
+/*!
+ * KlipperBackendBenchmark::listDigests
+ * @brief Lists the digests of the history, as a refresh of a clipboard offering them does.
+ * @author Christian Reiner
+ */
+void KlipperBackendBenchmark::listDigests ( )
+{
+  QFETCH ( QString, size );
+  klipper ( 0, size );
+  KlipperBackend _backend;
+  QVERIFY ( _backend.capabilities() & ClipboardBackend::CAP_DIGESTS );
+  int _entries = 0;
+  QBENCHMARK
+  {
+    _entries = _backend.getClipboardHistoryDigests().size ( );
+  }
+  QCOMPARE ( _entries, int(C_capacity) );
+} // KlipperBackendBenchmark::listDigests
+
+/*!
+ * KlipperBackendBenchmark::fetchedOneByOne
+ * @brief Fetches entries by blocking requests, each waited for before the next one is sent.
+ * @author Christian Reiner
+ */
+void KlipperBackendBenchmark::fetchedOneByOne ( )
+{
+  QFETCH ( int, latency );
+  klipper ( latency );
+  DBusClient _client ( "org.kde.klipper", "/klipper", "org.kde.klipper.klipper" );
+  int _fetched = 0;
+  QBENCHMARK
+  {
+    _fetched = 0;
+    for ( int _index=0; _index<C_fetched; _index++ )
+    {
+      _client.call ( "getClipboardHistoryItem", _index );
+      _fetched += ( ! _client.result().value(0).toString().isEmpty() );
+    }
+  }
+  QCOMPARE ( _fetched, int(C_fetched) );
+} // KlipperBackendBenchmark::fetchedOneByOne
+
+/*!
+ * KlipperBackendBenchmark::fetchedInFlight
+ * @brief Fetches entries by sending all requests first, then collecting the replies.
+ * @author Christian Reiner
+ */
+void KlipperBackendBenchmark::fetchedInFlight ( )
+{
+  QFETCH ( int, latency );
+  klipper ( latency );
+  DBusClient _client ( "org.kde.klipper", "/klipper", "org.kde.klipper.klipper" );
+  int _fetched = 0;
+  QBENCHMARK
+  {
+    _fetched = 0;
+    QList<QDBusMessage>     _messages;
+    QList<QDBusPendingCall> _pending;
+    for ( int _index=0; _index<C_fetched; _index++ )
+    {
+      _messages << _client.message ( "getClipboardHistoryItem", QList<QVariant>() << _index );
+      _pending  << _client.asyncCall ( _messages.last() );
+    }
+    for ( int _index=0; _index<C_fetched; _index++ )
+      _fetched += ( ! _client.wait(_pending[_index],_messages[_index],TRUE).value(0).toString().isEmpty() );
+  }
+  QCOMPARE ( _fetched, int(C_fetched) );
+} // KlipperBackendBenchmark::fetchedInFlight
+
+/*!
+ * KlipperBackendBenchmark::perCall_data
+ * @brief The ways of calling klipper: typed proxy, generic call and introspecting proxy.
+ * @author Christian Reiner
+ */
+void KlipperBackendBenchmark::perCall_data ( )
+{
+  QTest::addColumn<QString> ( "proxy" );
+  QTest::newRow ( "typed proxy" )         << QString ( "typed" );
+  QTest::newRow ( "generic call" )        << QString ( "generic" );
+  QTest::newRow ( "introspecting proxy" ) << QString ( "introspecting" );
+} // KlipperBackendBenchmark::perCall_data
+
+/*!
+ * KlipperBackendBenchmark::perCall
+ * @brief Reads the current clipboard content 1000 times, klipper answers without latency.
+ * The figures divided by 1000 are the time per call.
+ * @author Christian Reiner
+ */
+void KlipperBackendBenchmark::perCall ( )
+{
+  QFETCH ( QString, proxy );
+  klipper ( 0 );
+  KlipperBackend _backend;
+  DBusClient     _client ( "org.kde.klipper", "/klipper", "org.kde.klipper.klipper" );
+  QDBusInterface _klipper ( "org.kde.klipper", "/klipper", "org.kde.klipper.klipper" );
+  const QString _expected = _backend.getClipboardContents ( );
+  QString _entry;
+  QBENCHMARK
+  {
+    for ( int _call=0; _call<C_calls; _call++ )
+      if ( "typed"==proxy )
+        _entry = _backend.getClipboardContents ( );
+      else if ( "generic"==proxy )
+      {
+        _client.call ( "getClipboardContents" );
+        QVariant _result = _client.result().value ( 0 );
+        _entry = _client.convertReturnValue(_result,QVariant::String).toString ( );
+      }
+      else
+        _entry = _klipper.call("getClipboardContents").arguments().value(0).toString ( );
+  }
+  QCOMPARE ( _entry, _expected );
+} // KlipperBackendBenchmark::perCall
+
+QTEST_KDEMAIN ( KlipperBackendBenchmark, NoGUI )
+
+#include "klipper_backend_benchmark.moc"
@@ -0,0 +1,243 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Unit test of the optional capabilities of klipper as used by classes KlipperBackend and KlipperFrontend
+ * @see KlipperFrontendTest
+ * @author Christian Reiner
+ */
+
+#include <QtTest>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QScopedPointer>
+#include <QtDBus/QDBusInterface>
+#include <qtest_kde.h>
+#include <kshareddatacache.h>
+#include <kstandarddirs.h>
+#include "clipboard/klipper/klipper_backend.h"
+#include "clipboard/klipper/klipper_frontend.h"
+#include "tests/test_bus.h"
+
+using namespace KIO_CLIPBOARD;
+
+/*!
+ * class KlipperFrontendTest
+ * @brief Checks that digests and the generation counter are detected, delivered and used to refresh the nodes,
+ * and that klipper lacking them is still listed completely.
+ * The mock klipper runs on a private bus, each test uses a clipboard name and so a cache of its own.
+ * The change signal is switched off where the backend generation is tested, the tracker would answer first otherwise.
+ * @author Christian Reiner
+ */
+class KlipperFrontendTest
+  : public QObject
+{
+  Q_OBJECT
+  private:
+    TestBus m_bus;
+    QString m_name;
+    int     m_test;
+    KlipperFrontend* frontend ( ) const;
+    static QStringList history ( );
+    static void push ( const QString& entry );
+    static void compare ( const KlipperFrontend& clipboard );
+  private slots:
+    void initTestCase         ( );
+    void init                 ( );
+    void cleanup              ( );
+    void capabilitiesDetected ( );
+    void digestsListed        ( );
+    void generationCounted    ( );
+    void refreshedByDigests   ( );
+    void refreshedCompletely  ( );
+}; // class KlipperFrontendTest
+
+/*!
+ * KlipperFrontendTest::frontend
+ * @brief Constructs a frontend of the mock klipper, using the clipboard name of the current test.
+ * @return frontend, owned by the caller
+ * @author Christian Reiner
+ */
+KlipperFrontend* KlipperFrontendTest::frontend ( ) const
+{
+  return new KlipperFrontend ( KUrl("klipper:/"), m_name );
+} // KlipperFrontendTest::frontend
+
+/*!
+ * KlipperFrontendTest::history
+ * @brief The history held by the mock klipper, newest first.
+ * @return payloads of all entries
+ * @author Christian Reiner
+ */
+QStringList KlipperFrontendTest::history ( )
+{
+  QDBusInterface _klipper ( "org.kde.klipper", "/klipper", "org.kde.klipper.klipper" );
+  return _klipper.call("getClipboardHistoryMenu").arguments().value(0).toStringList ( );
+} // KlipperFrontendTest::history
+
+/*!
+ * KlipperFrontendTest::push
+ * @brief Adds an entry to the history of the mock klipper.
+ * @param entry payload of the entry
+ * @author Christian Reiner
+ */
+void KlipperFrontendTest::push ( const QString& entry )
+{
+  QDBusInterface _klipper ( "org.kde.klipper", "/klipper", "org.kde.klipper.klipper" );
+  _klipper.call ( "setClipboardContents", entry );
+} // KlipperFrontendTest::push
+
+/*!
+ * KlipperFrontendTest::compare
+ * @brief Checks that the nodes of a frontend match the history of the mock klipper, in the same order.
+ * @param clipboard frontend whose nodes have been refreshed
+ * @author Christian Reiner
+ */
+void KlipperFrontendTest::compare ( const KlipperFrontend& clipboard )
+{
+  const QStringList _history = history ( );
+  QCOMPARE ( clipboard.nodes().size(), _history.size() );
+  for ( int _position=0; _position<_history.size(); _position++ )
+  {
+    const NodeWrapper* _node = clipboard.nodes().at ( _position );
+    QCOMPARE ( _node->name(), NodeWrapper::payload2name(_history.at(_position),clipboard.mappingNameHash()) );
+    QCOMPARE ( _node->index(), _position+1 );
+  }
+} // KlipperFrontendTest::compare
+
+/*!
+ * KlipperFrontendTest::initTestCase
+ * @brief Starts the private bus.
+ * @author Christian Reiner
+ */
+void KlipperFrontendTest::initTestCase ( )
+{
+  m_test = 0;
+  QVERIFY ( m_bus.start() );
+} // KlipperFrontendTest::initTestCase
+
+/*!
+ * KlipperFrontendTest::init
+ * @brief Picks a fresh clipboard name for the test, so nodes of former tests or runs do not interfere.
+ * @author Christian Reiner
+ */
+void KlipperFrontendTest::init ( )
+{
+  m_name = QString ( "klipper-test-%1-%2" ).arg(QCoreApplication::applicationPid()).arg(++m_test);
+} // KlipperFrontendTest::init
+
+/*!
+ * KlipperFrontendTest::cleanup
+ * @brief Removes the cache and the node table of the test.
+ * @author Christian Reiner
+ */
+void KlipperFrontendTest::cleanup ( )
+{
+  KSharedDataCache::deleteCache ( QString("kio-clipboard-%1").arg(m_name) );
+  const QString _table = KStandardDirs::locateLocal ( "tmp", QString("kio-clipboard-%1.nodes").arg(m_name) );
+  QFile::remove ( _table );
+  QFile::remove ( _table+".lock" );
+} // KlipperFrontendTest::cleanup
+
+/*!
+ * KlipperFrontendTest::capabilitiesDetected
+ * @brief Klipper offers no capabilities, the mock offering digests and a generation is recognized as such.
+ * @author Christian Reiner
+ */
+void KlipperFrontendTest::capabilitiesDetected ( )
+{
+  QVERIFY ( m_bus.startKlipper(QStringList()<<"--entries"<<"20") );
+  {
+    KlipperBackend _backend;
+    QCOMPARE ( _backend.capabilities(), int(ClipboardBackend::CAP_NONE) );
+  }
+  QVERIFY ( m_bus.startKlipper(QStringList()<<"--entries"<<"20"<<"--digests") );
+  KlipperBackend _backend;
+  QCOMPARE ( _backend.capabilities(), int(ClipboardBackend::CAP_DIGESTS|ClipboardBackend::CAP_GENERATION) );
+} // KlipperFrontendTest::capabilitiesDetected
+
+/*!
+ * KlipperFrontendTest::digestsListed
+ * @brief Digests describe the entries of the history in the same order, by hash and size.
+ * @author Christian Reiner
+ */
+void KlipperFrontendTest::digestsListed ( )
+{
+  QVERIFY ( m_bus.startKlipper(QStringList()<<"--entries"<<"20"<<"--size"<<"16:4096"<<"--mixed"<<"--digests") );
+  KlipperBackend _backend;
+  const QStringList _history = _backend.getClipboardHistoryMenu ( );
+  const QList<ClipboardDigest> _digests = _backend.getClipboardHistoryDigests ( );
+  QCOMPARE ( _digests.size(), _history.size() );
+  for ( int _position=0; _position<_history.size(); _position++ )
+  {
+    const QByteArray _hash = QCryptographicHash::hash ( _history.at(_position).toUtf8(), QCryptographicHash::Md5 ).toHex ( );
+    QCOMPARE ( _digests.at(_position).hash, QString::fromLatin1(_hash) );
+    QCOMPARE ( _digests.at(_position).size, _history.at(_position).size() );
+  }
+} // KlipperFrontendTest::digestsListed
+
+/*!
+ * KlipperFrontendTest::generationCounted
+ * @brief The generation changes with each change of the history, and only then.
+ * @author Christian Reiner
+ */
+void KlipperFrontendTest::generationCounted ( )
+{
+  QVERIFY ( m_bus.startKlipper(QStringList()<<"--entries"<<"20"<<"--digests") );
+  KlipperBackend _backend;
+  const int _generation = _backend.getClipboardGeneration ( );
+  QCOMPARE ( _backend.getClipboardGeneration(), _generation );
+  _backend.setClipboardContents ( "generationCounted" );
+  QVERIFY ( _generation!=_backend.getClipboardGeneration() );
+} // KlipperFrontendTest::generationCounted
+
+/*!
+ * KlipperFrontendTest::refreshedByDigests
+ * @brief Nodes refreshed from digests match the history, whether it is unchanged, has grown or has been reordered.
+ * @author Christian Reiner
+ */
+void KlipperFrontendTest::refreshedByDigests ( )
+{
+  QVERIFY ( m_bus.startKlipper(QStringList()<<"--entries"<<"20"<<"--size"<<"16:4096"<<"--mixed"<<"--digests"<<"--no-signal") );
+  QScopedPointer<KlipperFrontend> _clipboard ( frontend() );
+  _clipboard->refreshNodes ( );
+  compare ( *_clipboard );
+  // an unchanged generation keeps the nodes
+  const int _generation = _clipboard->generation ( );
+  _clipboard->refreshNodes ( );
+  QCOMPARE ( _clipboard->generation(), _generation );
+  // a new entry pushes the oldest one out
+  push ( "refreshedByDigests" );
+  _clipboard->refreshNodes ( );
+  QVERIFY ( _clipboard->generation()!=_generation );
+  compare ( *_clipboard );
+  // an entry moved to the top is known by its digest
+  push ( history().last() );
+  _clipboard->refreshNodes ( );
+  compare ( *_clipboard );
+} // KlipperFrontendTest::refreshedByDigests
+
+/*!
+ * KlipperFrontendTest::refreshedCompletely
+ * @brief Nodes of a klipper lacking digests and generation are refreshed from the complete history.
+ * @author Christian Reiner
+ */
+void KlipperFrontendTest::refreshedCompletely ( )
+{
+  QVERIFY ( m_bus.startKlipper(QStringList()<<"--entries"<<"20"<<"--mixed"<<"--no-signal") );
+  QScopedPointer<KlipperFrontend> _clipboard ( frontend() );
+  _clipboard->refreshNodes ( );
+  compare ( *_clipboard );
+  push ( "refreshedCompletely" );
+  _clipboard->refreshNodes ( );
+  compare ( *_clipboard );
+} // KlipperFrontendTest::refreshedCompletely
+
+QTEST_KDEMAIN ( KlipperFrontendTest, NoGUI )
+
+#include "klipper_frontend_test.moc"
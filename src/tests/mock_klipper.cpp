@@ -0,0 +1,182 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Mock of the dbus service 'org.kde.klipper', used by tests and benchmarks
+ * The mock implements the interface org.kde.klipper.klipper as declared in clipboard/klipper/org.kde.klipper.xml
+ * and emits the change signal newer versions of klipper offer. It is meant to be run on a private bus, see TestBus.
+ * Usage: mock_klipper [--entries N] [--size MIN[:MAX]] [--latency USECS] [--mixed] [--no-signal] [--digests]
+ * - entries: number of entries the history is filled with initially, also the maximum size of the history (default 100)
+ * - size:    size of each generated entry in characters, random between MIN and MAX if given (default 256)
+ * - latency: time in microseconds each method call is delayed, to mimic a busy desktop (default 0)
+ * - mixed:   every fifth entry is an url and every fifth a path instead of plain text
+ * - no-signal: the change signal is neither offered nor emitted, like older versions of klipper
+ * - digests: the history can also be listed as digests and the changes are counted, klipper itself offers neither,
+ *            see MockKlipperDigests and the capabilities of ClipboardBackend
+ * @see MockKlipper
+ * @author Christian Reiner
+ */
+
+#include <unistd.h>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QScopedPointer>
+#include <QStringList>
+#include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusError>
+
+namespace KIO_CLIPBOARD
+{
+  /*!
+   * class MockKlipper
+   * @brief Clipboard history held in memory and offered on dbus just like klipper does.
+   * The history is ordered newest first, setting the clipboard contents moves an existing entry to the top, like klipper.
+   * Calls are answered one after another, so an injected latency adds up for concurrent callers, again like klipper.
+   * @author Christian Reiner
+   */
+  class MockKlipper
+    : public QObject
+  {
+    Q_OBJECT
+    Q_CLASSINFO ( "D-Bus Interface", "org.kde.klipper.klipper" )
+    protected:
+      QStringList m_history;
+      const int   m_capacity;
+      const int   m_latency;
+      const bool  m_signal;
+      int         m_generation;
+      inline void delay   ( ) const { if ( 0<m_latency ) ::usleep ( m_latency ); };
+      inline void changed ( )       { ++m_generation; if ( m_signal ) emit clipboardHistoryUpdated ( ); };
+    public:
+      MockKlipper ( const QStringList& history, int capacity, int latency, bool signal )
+        : QObject ( ), m_history ( history ), m_capacity ( capacity ), m_latency ( latency ), m_signal ( signal ), m_generation ( 0 ) { };
+    public slots:
+      Q_SCRIPTABLE QString getClipboardContents ( )
+        { delay(); return m_history.value ( 0 ); };
+      Q_SCRIPTABLE void setClipboardContents ( const QString& s )
+        { delay(); m_history.removeAll(s); m_history.prepend(s); while ( m_history.size()>m_capacity ) m_history.removeLast(); changed(); };
+      Q_SCRIPTABLE void clearClipboardContents ( )
+        { delay(); if ( ! m_history.isEmpty() ) m_history.removeFirst(); changed(); };
+      Q_SCRIPTABLE void clearClipboardHistory ( )
+        { delay(); m_history.clear(); changed(); };
+      Q_SCRIPTABLE QStringList getClipboardHistoryMenu ( )
+        { delay(); return m_history; };
+      Q_SCRIPTABLE QString getClipboardHistoryItem ( int i )
+        { delay(); return m_history.value ( i ); };
+      Q_SCRIPTABLE void showKlipperPopupMenu ( )
+        { delay(); };
+      Q_SCRIPTABLE void showKlipperManuallyInvokeActionMenu ( )
+        { delay(); };
+    signals:
+      Q_SCRIPTABLE void clipboardHistoryUpdated ( );
+  }; // class MockKlipper
+
+  /*!
+   * class MockKlipperDigests
+   * @brief Mock klipper offering the optional methods a clipboard may offer besides the interface of klipper.
+   * - getClipboardHistoryDigests: the history newest first, each entry as its MD5 hash in hex and its size in characters,
+   *   separated by a blank, so only the digests are transferred
+   * - getClipboardGeneration: number of changes of the history since the mock started
+   * @author Christian Reiner
+   */
+  class MockKlipperDigests
+    : public MockKlipper
+  {
+    Q_OBJECT
+    Q_CLASSINFO ( "D-Bus Interface", "org.kde.klipper.klipper" )
+    public:
+      MockKlipperDigests ( const QStringList& history, int capacity, int latency, bool signal )
+        : MockKlipper ( history, capacity, latency, signal ) { };
+    public slots:
+      Q_SCRIPTABLE QStringList getClipboardHistoryDigests ( )
+      {
+        delay ( );
+        QStringList _digests;
+        foreach ( const QString& _entry, m_history )
+          _digests << QString ( "%1 %2" ).arg ( QString::fromLatin1(QCryptographicHash::hash(_entry.toUtf8(),QCryptographicHash::Md5).toHex()) )
+                                         .arg ( _entry.size() );
+        return _digests;
+      };
+      Q_SCRIPTABLE int getClipboardGeneration ( )
+        { delay(); return m_generation; };
+  }; // class MockKlipperDigests
+
+} // namespace KIO_CLIPBOARD
+
+using namespace KIO_CLIPBOARD;
+
+/*!
+ * option
+ * @brief Value of a command line option.
+ * @param arguments command line arguments
+ * @param name name of the option, for example "--entries"
+ * @param fallback value used if the option is not given
+ * @return value following the option name
+ * @author Christian Reiner
+ */
+static QString option ( const QStringList& arguments, const QString& name, const QString& fallback )
+{
+  const int _position = arguments.indexOf ( name );
+  return ( -1==_position || _position+1>=arguments.size() ) ? fallback : arguments.at ( _position+1 );
+} // option
+
+/*!
+ * entry
+ * @brief Generates the payload of an entry of the initial history.
+ * @param index position of the entry in the history, each entry is unique
+ * @param size size of the entry in characters, urls and paths are not padded
+ * @param mixed true if urls and paths are generated besides plain text
+ * @return payload
+ * @author Christian Reiner
+ */
+static QString entry ( int index, int size, bool mixed )
+{
+  if ( mixed && 1==index%5 )
+    return QString ( "http://www.example.org/entries/%1.html" ).arg ( index );
+  if ( mixed && 3==index%5 )
+    return QString ( "/tmp/kio-clipboard-mock/entry-%1" ).arg ( index );
+  static const QString C_filler = QString::fromLatin1 ( " The quick brown fox jumps over the lazy dog." );
+  QString _payload = QString ( "entry %1:" ).arg ( index );
+  _payload.reserve ( size );
+  while ( _payload.size()<size )
+    _payload.append ( C_filler.left(size-_payload.size()) );
+  return _payload;
+} // entry
+
+int main ( int argc, char** argv )
+{
+  QCoreApplication _app ( argc, argv );
+  const QStringList _arguments = _app.arguments ( );
+  const int  _entries = option ( _arguments, "--entries", "100" ).toInt ( );
+  const int  _latency = option ( _arguments, "--latency", "0" ).toInt ( );
+  const QStringList _size = option ( _arguments, "--size", "256" ).split ( ':' );
+  const int  _minimum = _size.first().toInt ( );
+  const int  _maximum = qMax ( _minimum, _size.last().toInt() );
+  const bool _mixed   = _arguments.contains ( "--mixed" );
+  const bool _signal  = ! _arguments.contains ( "--no-signal" );
+  const bool _digests = _arguments.contains ( "--digests" );
+  // the same arguments always lead to the same history
+  qsrand ( _entries );
+  QStringList _history;
+  for ( int _index=0; _index<_entries; _index++ )
+    _history << entry ( _index, _minimum+qrand()%(_maximum-_minimum+1), _mixed );
+  QScopedPointer<MockKlipper> _klipper ( _digests ? new MockKlipperDigests ( _history, _entries, _latency, _signal )
+                                                 : new MockKlipper        ( _history, _entries, _latency, _signal ) );
+  QDBusConnection _bus = QDBusConnection::sessionBus ( );
+  const QDBusConnection::RegisterOptions _exported = _signal
+                                                   ? QDBusConnection::ExportScriptableSlots|QDBusConnection::ExportScriptableSignals
+                                                   : QDBusConnection::RegisterOptions ( QDBusConnection::ExportScriptableSlots );
+  if ( ! _bus.registerObject("/klipper",_klipper.data(),_exported) || ! _bus.registerService("org.kde.klipper") )
+  {
+    qWarning ( "mock_klipper: failed to offer service org.kde.klipper: %s", qPrintable(_bus.lastError().message()) );
+    return 1;
+  }
+  return _app.exec ( );
+} // main
+
+#include "mock_klipper.moc"
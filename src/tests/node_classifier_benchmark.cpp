@@ -0,0 +1,166 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Benchmark of the payload classification of class NodeClassifier
+ * @see NodeClassifierBenchmark
+ * @author Christian Reiner
+ */
+
+#include <QtTest>
+#include <QRegExp>
+#include <qtest_kde.h>
+#include "utility/regex.h"
+#include "protocol/kio_clipboard_protocol.h"
+#include "node/node_classifier.h"
+#include "tests/test_throughput.h"
+
+using namespace KIO_CLIPBOARD;
+
+/*!
+ * class NodeClassifierBenchmark
+ * @brief Compares the single-pass scanner of the classifier with the former "uri" and "path" patterns of the regex catalog.
+ * The payloads are the adversarial ones for the patterns: paths of many segments, hosts of many labels and payloads of
+ * several megabytes, each with a variant that only fails at its very end.
+ * The patterns backtrack on some of these for a long time, so this is not run as a test, only by 'make benchmark'.
+ * Besides that the mimetype detection of text entries of 100 bytes up to 50 megabytes is measured,
+ * sniffing a prefix of the configured length against sniffing the whole payload, which is what was done before.
+ * @author Christian Reiner
+ */
+class NodeClassifierBenchmark
+  : public QObject
+{
+  Q_OBJECT
+  private:
+    static NodeWrapper::Semantics match ( const QString& trimmed );
+  private slots:
+    void scanner_data  ( );
+    void scanner       ( );
+    void patterns_data ( );
+    void patterns      ( );
+    void sniffed_data  ( );
+    void sniffed       ( );
+}; // class NodeClassifierBenchmark
+
+/*!
+ * NodeClassifierBenchmark::match
+ * @brief Classifies a payload the way the classifier did before, by the patterns of the regex catalog.
+ * @param trimmed payload, stripped of leading and trailing white space
+ * @return semantics of the payload
+ * @author Christian Reiner
+ */
+NodeWrapper::Semantics NodeClassifierBenchmark::match ( const QString& trimmed )
+{
+  static regExPool _regEx;
+  if ( trimmed.isEmpty() )
+    return NodeWrapper::S_EMPTY;
+  if ( QRegExp(_regEx["uri"]).exactMatch(trimmed) )
+    return NodeWrapper::S_URL;
+  if ( QRegExp(_regEx["path"]).exactMatch(trimmed) )
+    return NodeWrapper::S_FILE;
+  return NodeWrapper::S_TEXT;
+} // NodeClassifierBenchmark::match
+
+/*!
+ * NodeClassifierBenchmark::scanner_data
+ * @brief Adversarial payloads, shared by both benchmarks.
+ * @author Christian Reiner
+ */
+void NodeClassifierBenchmark::scanner_data ( )
+{
+  QTest::addColumn<QString> ( "payload" );
+  QTest::newRow ( "path, 1000 segments" )                  << QString("/a").repeated ( 1000 );
+  QTest::newRow ( "path, 100000 segments" )                << QString("/a").repeated ( 100000 );
+  QTest::newRow ( "path, 100000 segments, failing last" )  << QString("/a").repeated ( 100000 ) + "//";
+  QTest::newRow ( "host, 1000 labels" )                    << "http://" + QString("a.").repeated ( 1000 ) + "org";
+  QTest::newRow ( "host, 1000 labels, failing last" )      << "http://" + QString("a.").repeated ( 1000 ) + "o_g";
+  QTest::newRow ( "host, 100000 labels" )                  << "http://" + QString("a.").repeated ( 100000 ) + "org";
+  QTest::newRow ( "url, 4 MB path" )                       << "http://www.kde.org" + QString("/a").repeated ( 1<<20 );
+  QTest::newRow ( "path, 4 MB" )                           << QString("/a").repeated ( 1<<20 );
+  QTest::newRow ( "path, 4 MB, failing last" )             << QString("/a").repeated ( 1<<20 ) + "//";
+  QTest::newRow ( "text, 4 MB" )                           << QString("The quick brown fox jumps over the lazy dog. ").repeated ( 1<<16 ).trimmed ( );
+} // NodeClassifierBenchmark::scanner_data
+
+/*!
+ * NodeClassifierBenchmark::scanner
+ * @brief Classifies by the single-pass scanner.
+ * @author Christian Reiner
+ */
+void NodeClassifierBenchmark::scanner ( )
+{
+  QFETCH ( QString, payload );
+  TestThroughput _throughput ( QTest::currentDataTag() );
+  QBENCHMARK
+  {
+    NodeClassifier::instance().semantics ( payload );
+    _throughput.add ( payload.size()*sizeof(QChar) );
+  }
+} // NodeClassifierBenchmark::scanner
+
+void NodeClassifierBenchmark::patterns_data ( ) { scanner_data(); }
+
+/*!
+ * NodeClassifierBenchmark::patterns
+ * @brief Classifies by the former patterns, both have to come to the same result.
+ * @author Christian Reiner
+ */
+void NodeClassifierBenchmark::patterns ( )
+{
+  QFETCH ( QString, payload );
+  NodeWrapper::Semantics _semantics = NodeWrapper::S_EMPTY;
+  {
+    TestThroughput _throughput ( QTest::currentDataTag() );
+    QBENCHMARK
+    {
+      _semantics = match ( payload );
+      _throughput.add ( payload.size()*sizeof(QChar) );
+    }
+  }
+  QCOMPARE ( NodeClassifier::instance().semantics(payload), _semantics );
+} // NodeClassifierBenchmark::patterns
+
+/*!
+ * NodeClassifierBenchmark::sniffed_data
+ * @brief Source code of 100 bytes up to 50 megabytes, sniffed by prefix and completely.
+ * @author Christian Reiner
+ */
+void NodeClassifierBenchmark::sniffed_data ( )
+{
+  QTest::addColumn<int>  ( "size" );
+  QTest::addColumn<bool> ( "complete" );
+  const int _sizes[] = { 100, 10*1024, 1024*1024, 50*1024*1024 };
+  const char* const _names[] = { "100 B", "10 KB", "1 MB", "50 MB" };
+  for ( unsigned int _size=0; _size<sizeof(_sizes)/sizeof(int); _size++ )
+  {
+    QTest::newRow ( qPrintable(QString("%1, prefix").arg(_names[_size])) )   << _sizes[_size] << false;
+    QTest::newRow ( qPrintable(QString("%1, complete").arg(_names[_size])) ) << _sizes[_size] << true;
+  }
+} // NodeClassifierBenchmark::sniffed_data
+
+/*!
+ * NodeClassifierBenchmark::sniffed
+ * @brief Detects the mimetype of a text payload and decides if it is code, as the classification of a text node does.
+ * @author Christian Reiner
+ */
+void NodeClassifierBenchmark::sniffed ( )
+{
+  QFETCH ( int,  size );
+  QFETCH ( bool, complete );
+  const QString _payload = QString("#include <stdio.h>\nint main ( int argc, char** argv ) { return 0; }\n").repeated(1+size/64).left ( size );
+  const int _sniffLength = complete ? _payload.size() : KIO_CLIPBOARD::C_mimetypeSniffLength;
+  TestThroughput _throughput ( QTest::currentDataTag() );
+  QBENCHMARK
+  {
+    NodeClassifier::instance().isCode ( NodeClassifier::instance().mimetype(_payload,_sniffLength) );
+    _throughput.add ( _payload.size()*sizeof(QChar) );
+  }
+} // NodeClassifierBenchmark::sniffed
+
+QTEST_KDEMAIN ( NodeClassifierBenchmark, NoGUI )
+
+#include "node_classifier_benchmark.moc"
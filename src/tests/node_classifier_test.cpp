@@ -0,0 +1,188 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Unit test of the payload classification of class NodeClassifier
+ * @see NodeClassifierTest
+ * @author Christian Reiner
+ */
+
+#include <QtTest>
+#include <QFile>
+#include <QTextStream>
+#include <QRegExp>
+#include <qtest_kde.h>
+#include "utility/regex.h"
+#include "node/node_classifier.h"
+
+using namespace KIO_CLIPBOARD;
+
+/*!
+ * class NodeClassifierTest
+ * @brief Pins the single-pass scanner of the classifier to the results of the former QRegExp patterns.
+ * - a golden corpus (node_classifier_corpus.txt) holds payloads together with the semantics the patterns decided upon,
+ *   it covers the corners of the patterns, like the '.' domain separator matching any character
+ * - randomly assembled payloads are checked against the "uri" and "path" patterns still held by the regex catalog
+ * @author Christian Reiner
+ */
+class NodeClassifierTest
+  : public QObject
+{
+  Q_OBJECT
+  private:
+    static QString semanticsName ( NodeWrapper::Semantics semantics );
+    static QString unescape      ( const QString& payload );
+    static QString patterns      ( const QString& trimmed );
+  private slots:
+    void corpus_data ( );
+    void corpus      ( );
+    void generated   ( );
+}; // class NodeClassifierTest
+
+/*!
+ * NodeClassifierTest::semanticsName
+ * @brief Name of a semantics value as used in the corpus.
+ * @param semantics semantics value
+ * @return name, for example "S_URL"
+ * @author Christian Reiner
+ */
+QString NodeClassifierTest::semanticsName ( NodeWrapper::Semantics semantics )
+{
+  switch ( semantics )
+  {
+    case NodeWrapper::S_EMPTY: return QString ( "S_EMPTY" );
+    case NodeWrapper::S_TEXT:  return QString ( "S_TEXT" );
+    case NodeWrapper::S_CODE:  return QString ( "S_CODE" );
+    case NodeWrapper::S_FILE:  return QString ( "S_FILE" );
+    case NodeWrapper::S_DIR:   return QString ( "S_DIR" );
+    case NodeWrapper::S_LINK:  return QString ( "S_LINK" );
+    case NodeWrapper::S_URL:   return QString ( "S_URL" );
+  }
+  return QString::number ( semantics );
+} // NodeClassifierTest::semanticsName
+
+/*!
+ * NodeClassifierTest::unescape
+ * @brief Resolves the escapes of a payload as written in the corpus.
+ * @param payload payload as written in the corpus
+ * @return the payload itself
+ * @author Christian Reiner
+ */
+QString NodeClassifierTest::unescape ( const QString& payload )
+{
+  QString _payload;
+  _payload.reserve ( payload.size() );
+  for ( int _i=0; _i<payload.size(); _i++ )
+  {
+    if ( '\\'!=payload.at(_i) || _i+1==payload.size() )
+      _payload.append ( payload.at(_i) );
+    else
+      switch ( payload.at(++_i).unicode() )
+      {
+        case 't': _payload.append ( '\t' ); break;
+        case 'n': _payload.append ( '\n' ); break;
+        default:  _payload.append ( payload.at(_i) );
+      }
+  }
+  return _payload;
+} // NodeClassifierTest::unescape
+
+/*!
+ * NodeClassifierTest::patterns
+ * @brief Classifies a payload the way the classifier did before, by the patterns of the regex catalog.
+ * @param trimmed payload, stripped of leading and trailing white space
+ * @return name of the semantics
+ * @author Christian Reiner
+ */
+QString NodeClassifierTest::patterns ( const QString& trimmed )
+{
+  static regExPool _regEx;
+  if ( trimmed.isEmpty() )
+    return semanticsName ( NodeWrapper::S_EMPTY );
+  if ( QRegExp(_regEx["uri"]).exactMatch(trimmed) )
+    return semanticsName ( NodeWrapper::S_URL );
+  if ( QRegExp(_regEx["path"]).exactMatch(trimmed) )
+    return semanticsName ( NodeWrapper::S_FILE );
+  return semanticsName ( NodeWrapper::S_TEXT );
+} // NodeClassifierTest::patterns
+
+/*!
+ * NodeClassifierTest::corpus_data
+ * @brief Reads the golden corpus, one test row per payload.
+ * @author Christian Reiner
+ */
+void NodeClassifierTest::corpus_data ( )
+{
+  QTest::addColumn<QString> ( "payload" );
+  QTest::addColumn<QString> ( "expected" );
+  QFile _file ( QString(KIO_CLIPBOARD_TEST_DATA) + "/node_classifier_corpus.txt" );
+  QVERIFY2 ( _file.open(QIODevice::ReadOnly|QIODevice::Text), qPrintable(_file.fileName()) );
+  QTextStream _stream ( &_file );
+  _stream.setCodec ( "UTF-8" );
+  int _line = 0;
+  while ( ! _stream.atEnd() )
+  {
+    const QString _row = _stream.readLine ( );
+    ++_line;
+    if ( _row.isEmpty() || '#'==_row.at(0) )
+      continue;
+    const int _tab = _row.indexOf ( '\t' );
+    QVERIFY ( 0<_tab );
+    QTest::newRow ( qPrintable(QString("line %1").arg(_line)) ) << unescape(_row.mid(_tab+1)) << _row.left(_tab);
+  }
+} // NodeClassifierTest::corpus_data
+
+/*!
+ * NodeClassifierTest::corpus
+ * @brief The classifier decides upon the semantics recorded in the corpus, just like the patterns of the regex catalog.
+ * @author Christian Reiner
+ */
+void NodeClassifierTest::corpus ( )
+{
+  QFETCH ( QString, payload );
+  QFETCH ( QString, expected );
+  QCOMPARE ( semanticsName(NodeClassifier::instance().semantics(payload)), expected );
+  QCOMPARE ( patterns(payload), expected );
+} // NodeClassifierTest::corpus
+
+/*!
+ * NodeClassifierTest::generated
+ * @brief The classifier agrees with the patterns of the regex catalog on randomly assembled payloads.
+ * Payloads are assembled from fragments of uris and paths, the sequence is seeded, so it is the same in every run.
+ * @author Christian Reiner
+ */
+void NodeClassifierTest::generated ( )
+{
+  static const char* const C_fragments[] = { "http", "ftp", "file", "kde", "org", "de", "www", "localhost", "index.html",
+                                             ".", ":", "://", ":/", "/", "//", "@", "?", "&", "=", "#", "_", "-",
+                                             "a", "z", "0", "123", "a=b", " ", "\t", "\n", "\\" };
+  static const int C_count = sizeof(C_fragments) / sizeof(C_fragments[0]);
+  qsrand ( 4 );
+  for ( int _round=0; _round<20000; _round++ )
+  {
+    QString _payload;
+    switch ( qrand()%3 )
+    {
+      case 0:  _payload = "http://"; break;
+      case 1:  _payload = "/";       break;
+      default: break;
+    }
+    for ( int _fragments=1+qrand()%12; 0<_fragments; _fragments-- )
+      _payload += QString::fromUtf8 ( C_fragments[qrand()%C_count] );
+    if ( 0==qrand()%16 )
+      _payload += QString::fromUtf8 ( "\xc3\xbc" );
+    const QString _trimmed = _payload.trimmed ( );
+    const QString _expected = patterns ( _trimmed );
+    if ( semanticsName(NodeClassifier::instance().semantics(_trimmed))!=_expected )
+      QFAIL ( qPrintable(QString("classified differently than by the patterns (%1): '%2'").arg(_expected).arg(_trimmed)) );
+  }
+} // NodeClassifierTest::generated
+
+QTEST_KDEMAIN ( NodeClassifierTest, NoGUI )
+
+#include "node_classifier_test.moc"
@@ -0,0 +1,298 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Micro benchmark of class NodeList
+ * @see NodeListBenchmark
+ * @author Christian Reiner
+ */
+
+#include <QtTest>
+#include <qtest_kde.h>
+#include "node/node_wrapper.h"
+#include "node/node_list.h"
+#include "tests/test_frontend.h"
+#include "tests/test_throughput.h"
+
+using namespace KIO_CLIPBOARD;
+
+/*!
+ * class NodeListBenchmark
+ * @brief Measures the serialization of node lists of 1000 and 10000 nodes, the binary snapshot against the JSON notation.
+ * The nodes are classified up front, so only the serialization is measured. The data rate is printed for each run.
+ * Besides that looking up all nodes by name, inserting all nodes and iterating over them in history order is measured,
+ * compared with the map ordered by name that the list was before.
+ * @author Christian Reiner
+ */
+class NodeListBenchmark
+  : public QObject
+{
+  Q_OBJECT
+  private:
+    enum { C_nodes = 10000 };
+    TestFrontend* m_clipboard;
+    NodeList      m_nodes;
+    NodeList head ( int count ) const;
+    static void sizes ( );
+    static void indexes ( );
+  private slots:
+    void initTestCase    ( );
+    void cleanupTestCase ( );
+    void snapshotWrite_data ( ) { sizes(); };
+    void snapshotWrite      ( );
+    void snapshotRead_data  ( ) { sizes(); };
+    void snapshotRead       ( );
+    void jsonWrite_data     ( ) { sizes(); };
+    void jsonWrite          ( );
+    void jsonRead_data      ( ) { sizes(); };
+    void jsonRead           ( );
+    void lookup_data        ( ) { indexes(); };
+    void lookup             ( );
+    void insert_data        ( ) { indexes(); };
+    void insert             ( );
+    void iterate_data       ( ) { indexes(); };
+    void iterate            ( );
+}; // class NodeListBenchmark
+
+/*!
+ * NodeListBenchmark::sizes
+ * @brief Rows of the data driven benchmarks: number of nodes in the list.
+ * @author Christian Reiner
+ */
+void NodeListBenchmark::sizes ( )
+{
+  QTest::addColumn<int> ( "count" );
+  QTest::newRow ( "1000 nodes" )  << 1000;
+  QTest::newRow ( "10000 nodes" ) << 10000;
+} // NodeListBenchmark::sizes
+
+/*!
+ * NodeListBenchmark::indexes
+ * @brief Rows of the index benchmarks: number of nodes and whether the former map is measured instead of the list.
+ * @author Christian Reiner
+ */
+void NodeListBenchmark::indexes ( )
+{
+  QTest::addColumn<int>  ( "count" );
+  QTest::addColumn<bool> ( "mapped" );
+  QTest::newRow ( "1000 nodes" )              << 1000  << false;
+  QTest::newRow ( "1000 nodes, former map" )  << 1000  << true;
+  QTest::newRow ( "10000 nodes" )             << 10000 << false;
+  QTest::newRow ( "10000 nodes, former map" ) << 10000 << true;
+} // NodeListBenchmark::indexes
+
+/*!
+ * NodeListBenchmark::head
+ * @brief List of the newest nodes of the history, sharing the nodes with the complete list.
+ * @param count number of nodes
+ * @return node list
+ * @author Christian Reiner
+ */
+NodeList NodeListBenchmark::head ( int count ) const
+{
+  NodeList _nodes;
+  _nodes.reserve ( count );
+  for ( int _position=0; _position<count && _position<m_nodes.size(); _position++ )
+    _nodes.append ( m_nodes.at(_position)->name(), m_nodes.at(_position) );
+  return _nodes;
+} // NodeListBenchmark::head
+
+/*!
+ * NodeListBenchmark::initTestCase
+ * @brief Constructs and classifies the nodes of a synthetic history.
+ * @author Christian Reiner
+ */
+void NodeListBenchmark::initTestCase ( )
+{
+  const QStringList _payloads = TestFrontend::history ( C_nodes );
+  m_clipboard = new TestFrontend ( _payloads );
+  for ( int _index=0; _index<_payloads.size(); _index++ )
+  {
+    NodeWrapper* _node = new NodeWrapper ( m_clipboard, _index+1, _payloads[_index] );
+    QVERIFY ( ! _node->title().isEmpty() );
+    QVERIFY ( m_nodes.append(_node->name(),_node) );
+  }
+} // NodeListBenchmark::initTestCase
+
+/*!
+ * NodeListBenchmark::cleanupTestCase
+ * @brief Releases the nodes and the clipboard.
+ * @author Christian Reiner
+ */
+void NodeListBenchmark::cleanupTestCase ( )
+{
+  qDeleteAll ( m_nodes.positions() );
+  m_nodes.clear ( );
+  delete m_clipboard;
+} // NodeListBenchmark::cleanupTestCase
+
+/*!
+ * NodeListBenchmark::snapshotWrite
+ * @brief Writes the binary snapshot, as a slave publishing its nodes does.
+ * @author Christian Reiner
+ */
+void NodeListBenchmark::snapshotWrite ( )
+{
+  QFETCH ( int, count );
+  const NodeList _nodes = head ( count );
+  TestThroughput _throughput ( "snapshot write" );
+  QBENCHMARK
+  {
+    _throughput.add ( _nodes.toSnapshot().size() );
+  }
+} // NodeListBenchmark::snapshotWrite
+
+/*!
+ * NodeListBenchmark::snapshotRead
+ * @brief Reads the binary snapshot, as a fresh slave seeding its nodes does.
+ * @author Christian Reiner
+ */
+void NodeListBenchmark::snapshotRead ( )
+{
+  QFETCH ( int, count );
+  const QByteArray _data = head(count).toSnapshot ( );
+  TestThroughput _throughput ( "snapshot read" );
+  QBENCHMARK
+  {
+    NodeList _nodes;
+    _nodes.fromSnapshot ( _data );
+    QCOMPARE ( _nodes.size(), count );
+    qDeleteAll ( _nodes.positions() );
+    _throughput.add ( _data.size() );
+  }
+} // NodeListBenchmark::snapshotRead
+
+/*!
+ * NodeListBenchmark::jsonWrite
+ * @brief Writes the JSON notation, as the slaves did before the snapshot was introduced.
+ * @author Christian Reiner
+ */
+void NodeListBenchmark::jsonWrite ( )
+{
+  QFETCH ( int, count );
+  const NodeList _nodes = head ( count );
+  TestThroughput _throughput ( "json write" );
+  QBENCHMARK
+  {
+    _throughput.add ( _nodes.toJSON().size() );
+  }
+} // NodeListBenchmark::jsonWrite
+
+/*!
+ * NodeListBenchmark::jsonRead
+ * @brief Reads the JSON notation, as still done for data left by older versions.
+ * @author Christian Reiner
+ */
+void NodeListBenchmark::jsonRead ( )
+{
+  QFETCH ( int, count );
+  const QByteArray _data = head(count).toJSON ( );
+  TestThroughput _throughput ( "json read" );
+  QBENCHMARK
+  {
+    NodeList _nodes;
+    _nodes.fromJSON ( _data );
+    QCOMPARE ( _nodes.size(), count );
+    qDeleteAll ( _nodes.positions() );
+    _throughput.add ( _data.size() );
+  }
+} // NodeListBenchmark::jsonRead
+
+/*!
+ * NodeListBenchmark::lookup
+ * @brief Looks up every node by its name, as resolving the url of a request does.
+ * @author Christian Reiner
+ */
+void NodeListBenchmark::lookup ( )
+{
+  QFETCH ( int,  count );
+  QFETCH ( bool, mapped );
+  const NodeList _nodes = head ( count );
+  QMap<QString,const NodeWrapper*> _map;
+  QStringList _names;
+  foreach ( const NodeWrapper* _node, _nodes.positions() )
+  {
+    _map.insert ( _node->name(), _node );
+    _names << _node->name ( );
+  }
+  int _found = 0;
+  QBENCHMARK
+  {
+    _found = 0;
+    if ( mapped )
+      foreach ( const QString& _name, _names )
+        _found += ( 0!=_map.value(_name) );
+    else
+      foreach ( const QString& _name, _names )
+        _found += ( 0!=_nodes.value(_name) );
+  }
+  QCOMPARE ( _found, count );
+} // NodeListBenchmark::lookup
+
+/*!
+ * NodeListBenchmark::insert
+ * @brief Fills a list with all nodes in history order, as a refresh does.
+ * @author Christian Reiner
+ */
+void NodeListBenchmark::insert ( )
+{
+  QFETCH ( int,  count );
+  QFETCH ( bool, mapped );
+  const NodeList _nodes = head ( count );
+  int _size = 0;
+  QBENCHMARK
+  {
+    if ( mapped )
+    {
+      QMap<QString,const NodeWrapper*> _map;
+      foreach ( const NodeWrapper* _node, _nodes.positions() )
+        _map.insert ( _node->name(), _node );
+      _size = _map.size ( );
+    }
+    else
+    {
+      NodeList _list;
+      _list.reserve ( count );
+      foreach ( const NodeWrapper* _node, _nodes.positions() )
+        _list.append ( _node->name(), _node );
+      _size = _list.size ( );
+    }
+  }
+  QCOMPARE ( _size, count );
+} // NodeListBenchmark::insert
+
+/*!
+ * NodeListBenchmark::iterate
+ * @brief Visits all nodes, as a listing does. The list hands them out newest first, the map ordered by name.
+ * @author Christian Reiner
+ */
+void NodeListBenchmark::iterate ( )
+{
+  QFETCH ( int,  count );
+  QFETCH ( bool, mapped );
+  const NodeList _nodes = head ( count );
+  QMap<QString,const NodeWrapper*> _map;
+  foreach ( const NodeWrapper* _node, _nodes.positions() )
+    _map.insert ( _node->name(), _node );
+  qint64 _sum = 0;
+  QBENCHMARK
+  {
+    _sum = 0;
+    if ( mapped )
+      for ( QMap<QString,const NodeWrapper*>::const_iterator _node=_map.constBegin(); _node!=_map.constEnd(); ++_node )
+        _sum += _node.value()->size ( );
+    else
+      for ( NodeList::const_iterator _node=_nodes.constBegin(); _node!=_nodes.constEnd(); ++_node )
+        _sum += (*_node)->size ( );
+  }
+  QVERIFY ( 0<_sum );
+} // NodeListBenchmark::iterate
+
+QTEST_KDEMAIN ( NodeListBenchmark, NoGUI )
+
+#include "node_list_benchmark.moc"
@@ -0,0 +1,244 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Unit test of the serialization of class NodeList
+ * @see NodeListTest
+ * @author Christian Reiner
+ */
+
+#include <QtTest>
+#include <QDateTime>
+#include <qtest_kde.h>
+#include "utility/exception.h"
+#include "node/node_wrapper.h"
+#include "node/node_list.h"
+#include "tests/test_frontend.h"
+
+using namespace KIO_CLIPBOARD;
+
+/*!
+ * class NodeListTest
+ * @brief Checks that a node list survives its snapshot and JSON notations unchanged
+ * and that damaged snapshots are refused by an exception instead of crashing the slave.
+ * @author Christian Reiner
+ */
+class NodeListTest
+  : public QObject
+{
+  Q_OBJECT
+  private:
+    enum { C_fuzzRounds = 5000 };
+    TestFrontend* m_clipboard;
+    NodeList      m_nodes;
+    QByteArray    m_snapshot;
+    static void compare ( const NodeList& expected, const NodeList& actual );
+    static bool refused ( const QByteArray& data );
+  private slots:
+    void initTestCase    ( );
+    void cleanupTestCase ( );
+    void snapshotRoundTrip  ( );
+    void snapshotTruncated  ( );
+    void snapshotCorrupted  ( );
+    void jsonRoundTrip      ( );
+}; // class NodeListTest
+
+/*!
+ * NodeListTest::compare
+ * @brief Compares two node lists attribute by attribute.
+ * @param expected list as constructed from the payloads
+ * @param actual list as read back from some notation
+ * @author Christian Reiner
+ */
+void NodeListTest::compare ( const NodeList& expected, const NodeList& actual )
+{
+  QCOMPARE ( actual.size(), expected.size() );
+  for ( int _position=0; _position<expected.size(); _position++ )
+  {
+    const NodeWrapper* _expected = expected.at ( _position );
+    const NodeWrapper* _actual   = actual.at ( _position );
+    QCOMPARE ( _actual->name(),            _expected->name() );
+    QCOMPARE ( _actual->index(),           _expected->index() );
+    QCOMPARE ( _actual->size(),            _expected->size() );
+    QCOMPARE ( _actual->access(),          _expected->access() );
+    QCOMPARE ( _actual->title(),           _expected->title() );
+    QCOMPARE ( _actual->semantics(),       _expected->semantics() );
+    QCOMPARE ( _actual->mimetype()->name(), _expected->mimetype()->name() );
+    QCOMPARE ( _actual->url(),             _expected->url() );
+    QCOMPARE ( _actual->path(),            _expected->path() );
+    QCOMPARE ( _actual->icon(),            _expected->icon() );
+    QCOMPARE ( _actual->overlays(),        _expected->overlays() );
+    QCOMPARE ( _actual->nameCardinality(), _expected->nameCardinality() );
+    QVERIFY  ( actual.value(_expected->name())==_actual );
+  }
+} // NodeListTest::compare
+
+/*!
+ * NodeListTest::refused
+ * @brief Tells whether reading a snapshot is refused.
+ * @param data snapshot to be read
+ * @return true if an exception was thrown, false if a list could be read
+ * Nodes read from the snapshot are released again either way.
+ * @author Christian Reiner
+ */
+bool NodeListTest::refused ( const QByteArray& data )
+{
+  NodeList _nodes;
+  try
+  {
+    _nodes.fromSnapshot ( data );
+  }
+  catch ( Exception & )
+  {
+    return TRUE;
+  }
+  qDeleteAll ( _nodes.positions() );
+  return FALSE;
+} // NodeListTest::refused
+
+/*!
+ * NodeListTest::initTestCase
+ * @brief Constructs nodes of all semantics, with payloads holding characters beyond latin1 and surrogate pairs.
+ * @author Christian Reiner
+ */
+void NodeListTest::initTestCase ( )
+{
+  QStringList _payloads;
+  _payloads << QString ( "plain text entry" )
+            << QString::fromUtf8 ( "Gr\xc3\xbc\xc3\x9f" "e, \xe6\xbc\xa2\xe5\xad\x97 und \xf0\x9f\x98\x80" )
+            << QString ( "http://www.kde.org/" )
+            << QString ( "/tmp" )
+            << QString ( "int main ( int argc, char** argv ) { return 0; }" )
+            << QString ( "  " )
+            << QString ( 40000, QChar('x') );
+  m_clipboard = new TestFrontend ( _payloads );
+  for ( int _index=0; _index<_payloads.size(); _index++ )
+  {
+    const NodeWrapper* _node = new NodeWrapper ( m_clipboard, _index, _payloads[_index] );
+    QVERIFY ( m_nodes.append(_node->name(),_node) );
+  }
+  m_snapshot = m_nodes.toSnapshot ( );
+} // NodeListTest::initTestCase
+
+/*!
+ * NodeListTest::cleanupTestCase
+ * @brief Releases the nodes and the clipboard.
+ * @author Christian Reiner
+ */
+void NodeListTest::cleanupTestCase ( )
+{
+  qDeleteAll ( m_nodes.positions() );
+  m_nodes.clear ( );
+  delete m_clipboard;
+} // NodeListTest::cleanupTestCase
+
+/*!
+ * NodeListTest::snapshotRoundTrip
+ * @brief A list read from a snapshot equals the original and is written to the identical snapshot again.
+ * @author Christian Reiner
+ */
+void NodeListTest::snapshotRoundTrip ( )
+{
+  NodeList _nodes;
+  _nodes.fromSnapshot ( m_snapshot );
+  compare ( m_nodes, _nodes );
+  QCOMPARE ( _nodes.toSnapshot(), m_snapshot );
+  qDeleteAll ( _nodes.positions() );
+} // NodeListTest::snapshotRoundTrip
+
+/*!
+ * NodeListTest::snapshotTruncated
+ * @brief Every truncated snapshot is refused.
+ * @author Christian Reiner
+ */
+void NodeListTest::snapshotTruncated ( )
+{
+  for ( int _length=0; _length<m_snapshot.size(); _length++ )
+    if ( ! refused(m_snapshot.left(_length)) )
+      QFAIL ( qPrintable(QString("snapshot truncated to %1 of %2 bytes was accepted").arg(_length).arg(m_snapshot.size())) );
+} // NodeListTest::snapshotTruncated
+
+/*!
+ * NodeListTest::snapshotCorrupted
+ * @brief Randomly damaged snapshots are either refused or read, but never crash the reader.
+ * Each round damages a copy of the snapshot in one of several ways: flipping bits, overwriting bytes,
+ * overwriting a word by a huge length, cutting out or repeating a range of bytes.
+ * The seed is taken from KIO_CLIPBOARD_FUZZ_SEED if set, otherwise from the clock; it is printed to reproduce a failure.
+ * A damaged magic has to be refused, since the data is handed to the JSON reader then.
+ * @author Christian Reiner
+ */
+void NodeListTest::snapshotCorrupted ( )
+{
+  const QByteArray _seed = qgetenv ( "KIO_CLIPBOARD_FUZZ_SEED" );
+  const uint _value = _seed.isEmpty() ? uint(QDateTime::currentDateTime().toTime_t()) : _seed.toUInt();
+  qDebug ( "fuzzing with seed %u, set KIO_CLIPBOARD_FUZZ_SEED to repeat", _value );
+  qsrand ( _value );
+  const int _size = m_snapshot.size ( );
+  for ( int _round=0; _round<C_fuzzRounds; _round++ )
+  {
+    QByteArray _data ( m_snapshot );
+    const int _position = qrand() % _size;
+    const int _length   = 1 + qrand() % qMin(64,_size-_position);
+    switch ( qrand() % 5 )
+    {
+      case 0:
+        for ( int _flip=1+qrand()%16; _flip>0; _flip-- )
+        {
+          const int _at = qrand() % _size;
+          _data[_at] = char ( _data.at(_at) ^ (1<<(qrand()%8)) );
+        }
+        break;
+      case 1:
+        for ( int _at=_position; _at<_position+_length; _at++ )
+          _data[_at] = char ( qrand() );
+        break;
+      case 2:
+        // a length field grown beyond the data, or beyond what fits into memory
+        for ( int _at=_position; _at<qMin(_size,_position+4); _at++ )
+          _data[_at] = char ( 0xff );
+        _data[_position] = char ( qrand()%2 ? 0x7f : 0xff );
+        break;
+      case 3:
+        _data.remove ( _position, _length );
+        break;
+      default:
+        _data.insert ( _position, _data.mid(_position,_length) );
+    }
+    if ( _data==m_snapshot )
+      continue;
+    const bool _refused = refused ( _data );
+    if ( _data.left(4)!=m_snapshot.left(4) && ! _refused )
+      QFAIL ( qPrintable(QString("snapshot with damaged magic was accepted in round %1").arg(_round)) );
+  }
+} // NodeListTest::snapshotCorrupted
+
+/*!
+ * NodeListTest::jsonRoundTrip
+ * @brief A list read from its JSON notation equals the original.
+ * @author Christian Reiner
+ */
+void NodeListTest::jsonRoundTrip ( )
+{
+  NodeList _nodes;
+  _nodes.fromJSON ( m_nodes.toJSON() );
+  QCOMPARE ( _nodes.size(), m_nodes.size() );
+  foreach ( const NodeWrapper* _expected, m_nodes )
+  {
+    const NodeWrapper* _actual = _nodes.value ( _expected->name() );
+    QVERIFY  ( 0!=_actual );
+    QCOMPARE ( _actual->index(),     _expected->index() );
+    QCOMPARE ( _actual->size(),      _expected->size() );
+    QCOMPARE ( _actual->title(),     _expected->title() );
+    QCOMPARE ( _actual->semantics(), _expected->semantics() );
+  }
+  qDeleteAll ( _nodes.positions() );
+} // NodeListTest::jsonRoundTrip
+
+QTEST_KDEMAIN ( NodeListTest, NoGUI )
+
+#include "node_list_test.moc"
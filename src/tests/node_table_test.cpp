@@ -0,0 +1,169 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Unit test of the node table shared by the slave processes
+ * @see NodeTableTest
+ * @author Christian Reiner
+ */
+
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <qtest_kde.h>
+#include "node/node_table.h"
+
+using namespace KIO_CLIPBOARD;
+
+/*!
+ * class NodeTableTest
+ * @brief Checks that classifications written by several writers are all kept
+ * and that readers of an older table are not disturbed by a writer, nor crashed by a damaged table.
+ * Each table object plays a slave process of its own.
+ * @author Christian Reiner
+ */
+class NodeTableTest
+  : public QObject
+{
+  Q_OBJECT
+  private:
+    QString m_path;
+    static QString name ( int number );
+    static QMap<QString,QByteArray> classifications ( int first, int count );
+  private slots:
+    void init    ( );
+    void cleanup ( );
+    void writersMerged    ( );
+    void readersUndisturbed ( );
+    void damagedIgnored   ( );
+}; // class NodeTableTest
+
+/*!
+ * NodeTableTest::name
+ * @brief Node name of the given number, in the notation of a payload hash.
+ * @param number number of the node
+ * @return 32 hex digits
+ * @author Christian Reiner
+ */
+QString NodeTableTest::name ( int number )
+{
+  return QString("%1").arg(number,32,16,QChar('0'));
+} // NodeTableTest::name
+
+/*!
+ * NodeTableTest::classifications
+ * @brief Made up classifications of a range of nodes.
+ * @param first number of the first node
+ * @param count number of nodes
+ * @return classifications keyed by node name
+ * @author Christian Reiner
+ */
+QMap<QString,QByteArray> NodeTableTest::classifications ( int first, int count )
+{
+  QMap<QString,QByteArray> _classifications;
+  for ( int _number=first; _number<first+count; _number++ )
+    _classifications.insert ( name(_number), QByteArray("classification of ")+name(_number).toLatin1() );
+  return _classifications;
+} // NodeTableTest::classifications
+
+/*!
+ * NodeTableTest::init
+ * @brief Each test starts without a table file.
+ * @author Christian Reiner
+ */
+void NodeTableTest::init ( )
+{
+  m_path = QDir::temp().filePath ( QString("kio-clipboard-node_table_test-%1.nodes").arg(QCoreApplication::applicationPid()) );
+  QFile::remove ( m_path );
+} // NodeTableTest::init
+
+/*!
+ * NodeTableTest::cleanup
+ * @brief Removes the table file and its lock.
+ * @author Christian Reiner
+ */
+void NodeTableTest::cleanup ( )
+{
+  QFile::remove ( m_path );
+  QFile::remove ( m_path+".lock" );
+} // NodeTableTest::cleanup
+
+/*!
+ * NodeTableTest::writersMerged
+ * @brief Two writers publishing different nodes, both sets end up in the table.
+ * @author Christian Reiner
+ */
+void NodeTableTest::writersMerged ( )
+{
+  NodeTable _first  ( m_path );
+  NodeTable _second ( m_path );
+  QVERIFY ( ! _first.attach() );
+  QVERIFY ( _first.write(classifications(0,100)) );
+  QVERIFY ( _second.write(classifications(50,100)) );
+  NodeTable _reader ( m_path );
+  QVERIFY ( _reader.attach() );
+  QCOMPARE ( _reader.count(), 150 );
+  const QMap<QString,QByteArray> _expected = classifications ( 0, 150 );
+  QMap<QString,QByteArray>::const_iterator _iterator;
+  for ( _iterator=_expected.constBegin(); _iterator!=_expected.constEnd(); ++_iterator )
+  {
+    QByteArray _data;
+    QVERIFY ( _reader.find(_iterator.key(),_data) );
+    QCOMPARE ( _data, _iterator.value() );
+  }
+  QByteArray _data;
+  QVERIFY ( ! _reader.find(name(150),_data) );
+  QVERIFY ( ! _reader.find(QString("short"),_data) );
+} // NodeTableTest::writersMerged
+
+/*!
+ * NodeTableTest::readersUndisturbed
+ * @brief A reader keeps on reading the table it has mapped whilst another one is written, until it attaches again.
+ * @author Christian Reiner
+ */
+void NodeTableTest::readersUndisturbed ( )
+{
+  NodeTable _writer ( m_path );
+  QVERIFY ( _writer.write(classifications(0,10)) );
+  NodeTable _reader ( m_path );
+  QVERIFY ( _reader.attach() );
+  QByteArray _data;
+  QVERIFY ( _reader.find(name(5),_data) );
+  QVERIFY ( _writer.write(classifications(10,10)) );
+  QCOMPARE ( _reader.count(), 10 );
+  QVERIFY ( _reader.find(name(5),_data) );
+  QCOMPARE ( _data, classifications(5,1).value(name(5)) );
+  QVERIFY ( _reader.attach() );
+  QCOMPARE ( _reader.count(), 20 );
+} // NodeTableTest::readersUndisturbed
+
+/*!
+ * NodeTableTest::damagedIgnored
+ * @brief A truncated or garbled table is not mapped, writing replaces it.
+ * @author Christian Reiner
+ */
+void NodeTableTest::damagedIgnored ( )
+{
+  NodeTable _table ( m_path );
+  QVERIFY ( _table.write(classifications(0,10)) );
+  QFile _file ( m_path );
+  QVERIFY ( _file.open(QIODevice::ReadWrite) );
+  QVERIFY ( _file.resize(20) );
+  _file.close ( );
+  QVERIFY ( ! _table.attach() );
+  QVERIFY ( _file.open(QIODevice::WriteOnly|QIODevice::Truncate) );
+  _file.write ( QByteArray(4096,'x') );
+  _file.close ( );
+  QVERIFY ( ! _table.attach() );
+  QVERIFY ( _table.write(classifications(0,10)) );
+  QCOMPARE ( _table.count(), 10 );
+} // NodeTableTest::damagedIgnored
+
+QTEST_KDEMAIN ( NodeTableTest, NoGUI )
+
+#include "node_table_test.moc"
@@ -0,0 +1,241 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Micro benchmark of the UDS entries handed out by class NodeWrapper
+ * @see NodeWrapperBenchmark
+ * @author Christian Reiner
+ */
+
+#include <QtTest>
+#include <QRegExp>
+#include <malloc.h>
+#include <QFile>
+#include <qtest_kde.h>
+#include <kshareddatacache.h>
+#include <kstandarddirs.h>
+#include "utility/regex.h"
+#include "node/node_wrapper.h"
+#include "tests/test_frontend.h"
+
+using namespace KIO_CLIPBOARD;
+
+/*!
+ * class NodeWrapperBenchmark
+ * @brief Compares 10000 repeated requests of the UDS entries of a set of nodes, once served from the entries built before
+ * and once with every entry built again, as happened before the entries were kept.
+ * The nodes are classified up front, so only the assembly of the entries is measured.
+ * Besides that the construction of the nodes of a history of 10000 entries is measured, in time and in heap memory per node.
+ * It is compared with nodes each holding a regex catalog of their own, which is what every node carried before.
+ * Finally a refresh of 1000 and 10000 new entries is measured with nodes classified on construction, as before,
+ * against nodes classified lazily. Listing a node classifies it anyway, the saving is in refreshes
+ * and in requests for single nodes, which classify that node only.
+ * Classifications are shared through the cache of the clipboard, it is removed up front and each row uses entries of its own.
+ * @author Christian Reiner
+ */
+class NodeWrapperBenchmark
+  : public QObject
+{
+  Q_OBJECT
+  private:
+    enum { C_calls = 10000, C_history = 10000 };
+    TestFrontend*        m_clipboard;
+    QList<NodeWrapper*>  m_nodes;
+    static int heap ( );
+  private slots:
+    void initTestCase    ( );
+    void cleanupTestCase ( );
+    void reused  ( );
+    void rebuilt ( );
+    void constructed_data ( );
+    void constructed      ( );
+    void refreshed_data   ( );
+    void refreshed        ( );
+}; // class NodeWrapperBenchmark
+
+/*!
+ * NodeWrapperBenchmark::initTestCase
+ * @brief Removes classifications of former runs, then constructs and classifies nodes of the usual semantics.
+ * @author Christian Reiner
+ */
+void NodeWrapperBenchmark::initTestCase ( )
+{
+  KSharedDataCache::deleteCache ( QString("kio-clipboard-test") );
+  QFile::remove ( KStandardDirs::locateLocal("tmp",QString("kio-clipboard-test.nodes")) );
+  QStringList _payloads;
+  _payloads << QString ( "plain text entry" )
+            << QString ( "http://www.kde.org/" )
+            << QString ( "/tmp" )
+            << QString ( "int main ( int argc, char** argv ) { return 0; }" )
+            << QString ( 4000, QChar('x') );
+  m_clipboard = new TestFrontend ( _payloads );
+  for ( int _index=0; _index<_payloads.size(); _index++ )
+  {
+    NodeWrapper* _node = new NodeWrapper ( m_clipboard, _index, _payloads[_index] );
+    QVERIFY ( ! _node->toUDSEntry().stringValue(UDSEntry::UDS_NAME).isEmpty() );
+    m_nodes << _node;
+  }
+} // NodeWrapperBenchmark::initTestCase
+
+/*!
+ * NodeWrapperBenchmark::cleanupTestCase
+ * @brief Releases the nodes and the clipboard.
+ * @author Christian Reiner
+ */
+void NodeWrapperBenchmark::cleanupTestCase ( )
+{
+  qDeleteAll ( m_nodes );
+  m_nodes.clear ( );
+  delete m_clipboard;
+} // NodeWrapperBenchmark::cleanupTestCase
+
+/*!
+ * NodeWrapperBenchmark::reused
+ * @brief Entries requested again and again are handed out as built on the first request.
+ * @author Christian Reiner
+ */
+void NodeWrapperBenchmark::reused ( )
+{
+  int _fields = 0;
+  QBENCHMARK
+  {
+    for ( int _call=0; _call<C_calls; _call++ )
+      _fields += m_nodes.at(_call%m_nodes.size())->toUDSEntry().count ( );
+  }
+  QVERIFY ( 0<_fields );
+} // NodeWrapperBenchmark::reused
+
+/*!
+ * NodeWrapperBenchmark::rebuilt
+ * @brief Entries are built on every request, since each node is moved between requests.
+ * Moving a node is cheap, compare the figures with those of reused() to see what building an entry costs.
+ * @author Christian Reiner
+ */
+void NodeWrapperBenchmark::rebuilt ( )
+{
+  int _fields = 0;
+  QBENCHMARK
+  {
+    for ( int _call=0; _call<C_calls; _call++ )
+    {
+      NodeWrapper* _node = m_nodes.at ( _call%m_nodes.size() );
+      _node->setPosition ( _node->index(), 2+_call%2 );
+      _fields += _node->toUDSEntry().count ( );
+    }
+  }
+  QVERIFY ( 0<_fields );
+} // NodeWrapperBenchmark::rebuilt
+
+/*!
+ * NodeWrapperBenchmark::heap
+ * @brief Heap memory currently allocated by this process.
+ * @return allocated bytes
+ * @author Christian Reiner
+ */
+int NodeWrapperBenchmark::heap ( )
+{
+  return mallinfo().uordblks;
+} // NodeWrapperBenchmark::heap
+
+/*!
+ * NodeWrapperBenchmark::constructed_data
+ * @brief Nodes as constructed now and nodes holding a regex catalog each, as before.
+ * @author Christian Reiner
+ */
+void NodeWrapperBenchmark::constructed_data ( )
+{
+  QTest::addColumn<bool> ( "pooled" );
+  QTest::newRow ( "10000 entries" )                     << false;
+  QTest::newRow ( "10000 entries, regex pool per node" ) << true;
+} // NodeWrapperBenchmark::constructed_data
+
+/*!
+ * NodeWrapperBenchmark::constructed
+ * @brief Constructs and destroys the nodes of the whole history in each iteration, then prints the heap memory held per node.
+ * @author Christian Reiner
+ */
+void NodeWrapperBenchmark::constructed ( )
+{
+  QFETCH ( bool, pooled );
+  const QStringList _payloads = TestFrontend::history ( C_history );
+  QList<NodeWrapper*> _nodes;
+  QList<regExPool*>   _pools;
+  QBENCHMARK
+  {
+    for ( int _index=0; _index<_payloads.size(); _index++ )
+    {
+      _nodes << new NodeWrapper ( m_clipboard, _index+1, _payloads[_index] );
+      if ( pooled )
+        _pools << new regExPool;
+    }
+    qDeleteAll ( _nodes );
+    qDeleteAll ( _pools );
+    _nodes.clear ( );
+    _pools.clear ( );
+  }
+  // the payloads are shared with the history, so the memory is what the nodes add on top of it
+  const int _heap = heap ( );
+  for ( int _index=0; _index<_payloads.size(); _index++ )
+  {
+    _nodes << new NodeWrapper ( m_clipboard, _index+1, _payloads[_index] );
+    if ( pooled )
+      _pools << new regExPool;
+  }
+  qDebug ( "%s: %d bytes of heap per node", QTest::currentDataTag(), (heap()-_heap)/C_history );
+  QCOMPARE ( _nodes.size(), int(C_history) );
+  qDeleteAll ( _nodes );
+  qDeleteAll ( _pools );
+} // NodeWrapperBenchmark::constructed
+
+/*!
+ * NodeWrapperBenchmark::refreshed_data
+ * @brief Size of the history and whether nodes are classified on construction, each row with entries not seen before.
+ * @author Christian Reiner
+ */
+void NodeWrapperBenchmark::refreshed_data ( )
+{
+  QTest::addColumn<int>  ( "count" );
+  QTest::addColumn<bool> ( "eager" );
+  QTest::addColumn<int>  ( "first" );
+  QTest::newRow ( "1000 entries, eager" )  << 1000  << true  << 1000000;
+  QTest::newRow ( "1000 entries, lazy" )   << 1000  << false << 2000000;
+  QTest::newRow ( "10000 entries, eager" ) << 10000 << true  << 3000000;
+  QTest::newRow ( "10000 entries, lazy" )  << 10000 << false << 4000000;
+} // NodeWrapperBenchmark::refreshed_data
+
+/*!
+ * NodeWrapperBenchmark::refreshed
+ * @brief Constructs the nodes of a history, classifying each right away if eager.
+ * Run once only, a second run would find the classifications in the cache.
+ * @author Christian Reiner
+ */
+void NodeWrapperBenchmark::refreshed ( )
+{
+  QFETCH ( int,  count );
+  QFETCH ( bool, eager );
+  QFETCH ( int,  first );
+  const QStringList _payloads = TestFrontend::history ( count, first );
+  QList<NodeWrapper*> _nodes;
+  QBENCHMARK_ONCE
+  {
+    for ( int _index=0; _index<_payloads.size(); _index++ )
+    {
+      NodeWrapper* _node = new NodeWrapper ( m_clipboard, _index+1, _payloads[_index] );
+      if ( eager )
+        _node->semantics ( );
+      _nodes << _node;
+    }
+  }
+  QCOMPARE ( _nodes.size(), count );
+  QCOMPARE ( _nodes.last()->isClassified(), eager );
+  qDeleteAll ( _nodes );
+} // NodeWrapperBenchmark::refreshed
+
+QTEST_KDEMAIN ( NodeWrapperBenchmark, NoGUI )
+
+#include "node_wrapper_benchmark.moc"
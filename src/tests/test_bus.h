@@ -0,0 +1,119 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Declaration of class TestBus
+ * @see TestBus
+ * @author Christian Reiner
+ */
+
+#ifndef TESTS_TEST_BUS_H
+#define TESTS_TEST_BUS_H
+
+#include <unistd.h>
+#include <signal.h>
+#include <QCoreApplication>
+#include <QProcess>
+#include <QStringList>
+#include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusConnectionInterface>
+
+namespace KIO_CLIPBOARD
+{
+  /*!
+   * class TestBus
+   * @brief Private session bus with a mock klipper service on it, so tests and benchmarks never touch the desktop session.
+   * start() launches a dbus-daemon of its own and makes it the session bus of this process,
+   * so it has to be called before anything in this process connects to the session bus.
+   * The mock klipper (see mock_klipper.cpp) is started and stopped separately, so a test can restart it with different settings.
+   * Both processes are terminated when the object is destroyed.
+   * This class serves as a header-only library (no object file to be linked).
+   * @author Christian Reiner
+   */
+  class TestBus
+  {
+    private:
+      QProcess m_daemon;
+      QProcess m_klipper;
+      QString  m_address;
+      // milliseconds to wait for a process to come up or to go away
+      enum { C_timeout = 5000 };
+      static bool waitForService ( bool registered )
+      {
+        QDBusConnectionInterface* _bus = QDBusConnection::sessionBus().interface ( );
+        for ( int _waited=0; _waited<C_timeout; _waited+=10 )
+        {
+          if ( registered==_bus->isServiceRegistered("org.kde.klipper").value() )
+            return true;
+          QCoreApplication::processEvents ( );
+          ::usleep ( 10000 );
+        }
+        return false;
+      };
+    public:
+      inline TestBus ( ) { };
+      inline ~TestBus ( )
+      {
+        stopKlipper ( );
+        m_daemon.terminate ( );
+        if ( ! m_daemon.waitForFinished(C_timeout) )
+          m_daemon.kill ( );
+      };
+      inline const QString& address ( ) const { return m_address; };
+      inline Q_PID klipperPid ( ) const { return m_klipper.pid(); };
+      /*!
+       * TestBus::start
+       * @brief Launches the private dbus-daemon and makes it the session bus of this process and its children.
+       * @return true if the daemon is up and announced its address
+       */
+      inline bool start ( )
+      {
+        m_daemon.start ( "dbus-daemon", QStringList() << "--session" << "--nofork" << "--print-address" );
+        if ( ! m_daemon.waitForStarted(C_timeout) )
+          return false;
+        while ( ! m_daemon.canReadLine() )
+          if ( ! m_daemon.waitForReadyRead(C_timeout) )
+            return false;
+        m_address = QString::fromLocal8Bit ( m_daemon.readLine().trimmed() );
+        qputenv ( "DBUS_SESSION_BUS_ADDRESS", m_address.toLocal8Bit() );
+        return ! m_address.isEmpty() && QDBusConnection::sessionBus().isConnected();
+      };
+      /*!
+       * TestBus::startKlipper
+       * @brief Starts the mock klipper and waits for it to register its service.
+       * @param arguments command line arguments of the mock, see mock_klipper.cpp
+       * @return true if the service is available
+       */
+      inline bool startKlipper ( const QStringList& arguments=QStringList() )
+      {
+        stopKlipper ( );
+        m_klipper.setProcessChannelMode ( QProcess::ForwardedChannels );
+        m_klipper.start ( QCoreApplication::applicationDirPath()+"/mock_klipper", arguments );
+        return m_klipper.waitForStarted(C_timeout) && waitForService(true);
+      };
+      /*!
+       * TestBus::stopKlipper
+       * @brief Terminates the mock klipper, if running, and waits for its service to disappear.
+       */
+      inline void stopKlipper ( )
+      {
+        if ( QProcess::NotRunning==m_klipper.state() )
+          return;
+        // a stopped process would not handle the termination
+        ::kill ( m_klipper.pid(), SIGCONT );
+        m_klipper.terminate ( );
+        if ( ! m_klipper.waitForFinished(C_timeout) )
+          m_klipper.kill ( );
+        m_klipper.waitForFinished ( C_timeout );
+        waitForService ( false );
+      };
+  }; // class TestBus
+
+} // namespace KIO_CLIPBOARD
+
+#endif // TESTS_TEST_BUS_H
@@ -0,0 +1,99 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Declaration of class TestFrontend
+ * @see TestFrontend
+ * @author Christian Reiner
+ */
+
+#ifndef TESTS_TEST_FRONTEND_H
+#define TESTS_TEST_FRONTEND_H
+
+#include <QStringList>
+#include "clipboard/clipboard_backend.h"
+#include "clipboard/clipboard_frontend.h"
+
+namespace KIO_CLIPBOARD
+{
+  /*!
+   * class TestBackend
+   * @brief Backend of class TestFrontend, working on the list of entries held by the frontend.
+   * It offers no optional capabilities, so the nodes are always refreshed from the complete list of entries.
+   * @author Christian Reiner
+   */
+  class TestBackend
+    : public ClipboardBackend
+  {
+    private:
+      QStringList& m_payloads;
+    public:
+      inline TestBackend ( QStringList& payloads ) : ClipboardBackend ( ), m_payloads ( payloads ) { };
+      inline void        clearClipboardContents  ()                 { if ( ! m_payloads.isEmpty() ) m_payloads.removeFirst(); };
+      inline void        clearClipboardHistory   ()                 { m_payloads.clear(); };
+      inline QString     getClipboardContents    ()                 { return m_payloads.value(0); };
+      inline QStringList getClipboardHistoryMenu ()                 { return m_payloads; };
+      inline QString     getClipboardHistoryItem ( int index )      { return m_payloads.value(index-1); };
+      inline void        setClipboardContents    ( const QString& _entry ) { m_payloads.removeAll(_entry); m_payloads.prepend(_entry); };
+      inline void        setClipboardHistory     ( const QStringList& _entries )
+        { m_payloads.clear(); foreach ( const QString& _entry, _entries ) m_payloads.prepend(_entry); };
+  }; // class TestBackend
+
+  /*!
+   * class TestFrontend
+   * @brief Clipboard holding a list of entries in memory, used to construct nodes in tests.
+   * The entries are only changed by the test, nodes constructed for it are classified like those of any other clipboard.
+   * There is no tracker, so every refresh of the nodes lists all entries.
+   * This class serves as a header-only library (no object file to be linked).
+   * @author Christian Reiner
+   */
+  class TestFrontend
+    : public ClipboardFrontend
+  {
+    private:
+      QStringList m_payloads;
+    public:
+      inline TestFrontend ( const QStringList& payloads=QStringList() )
+        : ClipboardFrontend ( KUrl("clipboard:/test"), QString("test") ), m_payloads ( payloads )
+        { m_backend = new TestBackend ( m_payloads ); };
+      inline ~TestFrontend ( ) { delete m_backend; };
+      inline const ClipboardType type     ( ) const { return ClipboardType(KLIPPER); };
+      inline const QString       protocol ( ) const { return QString::fromLatin1("test"); };
+      inline const int           limit    ( ) const { return 32*1024; };
+      inline QString     getClipboardEntry   ( )           { return m_payloads.value(0); };
+      inline QString     getClipboardEntry   ( int index ) { return m_payloads.value(index); };
+      inline QStringList getClipboardEntries ( )           { return m_payloads; };
+      inline void        pushEntry ( const QString& entry ) { m_payloads.prepend(entry); };
+      inline void        delEntry  ( const KUrl& url )      { Q_UNUSED(url); };
+      inline void        setEntries ( const QStringList& payloads ) { m_payloads = payloads; };
+      /*!
+       * TestFrontend::history
+       * @brief Synthetic history of the usual mix of entries: text, code, urls, paths and some longer text.
+       * @param count number of entries
+       * @param first number of the first entry, histories of different numbers do not share any entry
+       * @return unique payloads, newest first
+       */
+      static inline QStringList history ( int count, int first=0 )
+      {
+        QStringList _payloads;
+        for ( int _number=first; _number<first+count; _number++ )
+          switch ( _number%5 )
+          {
+            case 0:  _payloads << QString("plain text entry %1").arg(_number); break;
+            case 1:  _payloads << QString("int main ( int argc, char** argv ) { return %1; }").arg(_number); break;
+            case 2:  _payloads << QString("http://www.kde.org/%1.html").arg(_number); break;
+            case 3:  _payloads << QString("/tmp/%1").arg(_number); break;
+            default: _payloads << QString("%1 ").arg(_number).repeated(200);
+          }
+        return _payloads;
+      };
+  }; // class TestFrontend
+
+} // namespace KIO_CLIPBOARD
+
+#endif // TESTS_TEST_FRONTEND_H
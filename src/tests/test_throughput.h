@@ -0,0 +1,49 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Declaration of class TestThroughput
+ * @see TestThroughput
+ * @author Christian Reiner
+ */
+
+#ifndef TESTS_TEST_THROUGHPUT_H
+#define TESTS_TEST_THROUGHPUT_H
+
+#include <QtGlobal>
+#include "utility/instrumentation.h"
+
+namespace KIO_CLIPBOARD
+{
+  /*!
+   * class TestThroughput
+   * @brief Measures the data rate of a benchmark, QBENCHMARK itself only reports the time per iteration.
+   * Placed in front of the QBENCHMARK block, the bytes processed are added up inside the block.
+   * The rate is printed when the object is destroyed, so it covers all iterations run by QBENCHMARK.
+   * This class serves as a header-only library (no object file to be linked).
+   * @author Christian Reiner
+   */
+  class TestThroughput
+  {
+    private:
+      const char*          m_what;
+      qint64               m_bytes;
+      InstrumentationClock m_clock;
+    public:
+      inline TestThroughput ( const char* what ) : m_what ( what ), m_bytes ( 0 ) { m_clock.start(); };
+      inline ~TestThroughput ( )
+      {
+        const qint64 _usecs = qMax ( qint64(1), elapsedUsecs(m_clock) );
+        qDebug ( "%s: %lld bytes in %lld us, %.3f GB/s", m_what, m_bytes, _usecs, m_bytes/(_usecs*1000.0) );
+      };
+      inline void add ( qint64 bytes ) { m_bytes += bytes; };
+  }; // class TestThroughput
+
+} // namespace KIO_CLIPBOARD
+
+#endif // TESTS_TEST_THROUGHPUT_H
@@ -0,0 +1,138 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Declares the payload hash strategies used to name nodes
+ * This is a header-only library, no additional implementation file exists, thus no linking is required.
+ * @see payloadHash
+ * @author Christian Reiner
+ */
+
+#ifndef UTILITY_HASH_H
+#define UTILITY_HASH_H
+
+#include <QtEndian>
+#include <QString>
+#include <QByteArray>
+#include <QCryptographicHash>
+
+namespace KIO_CLIPBOARD
+{
+  /*!
+   * PayloadHash
+   * @brief Strategies available to compute the hash of a payload.
+   * - H_MURMUR3: fast, non-cryptographic 128 bit hash computed directly on the UTF-16 (little endian) data of a payload
+   * - H_MD5: md5 hash of the UTF-8 encoded payload, the default, so names (urls) created by older versions stay valid
+   * Both hashes result in names of the same length, but switching between them changes all names.
+   * @author Christian Reiner
+   */
+  enum PayloadHash { H_MURMUR3, H_MD5 };
+
+  /*!
+   * murmur3
+   * @brief MurmurHash3 (x64, 128 bit variant) as published by Austin Appleby (public domain).
+   * @param data data to be hashed
+   * @param length length of the data in bytes
+   * @param seed seed of the hash
+   * @return 16 byte raw hash value
+   * The data is read as little endian words and the hash is written in little endian byte order,
+   * so the result does not depend on the byte order of the machine. Names derived from it end up in urls users keep.
+   * @author Christian Reiner
+   */
+  inline QByteArray murmur3 ( const char* data, int length, quint32 seed=0 )
+  {
+    #define MURMUR3_ROTL64(x,r) ( ((x)<<(r)) | ((x)>>(64-(r))) )
+    #define MURMUR3_FMIX64(k) { k^=k>>33; k*=Q_UINT64_C(0xff51afd7ed558ccd); k^=k>>33; k*=Q_UINT64_C(0xc4ceb9fe1a85ec53); k^=k>>33; }
+    const quint64 _c1 = Q_UINT64_C(0x87c37b91114253d5);
+    const quint64 _c2 = Q_UINT64_C(0x4cf5ad432745937f);
+    const int _blocks = length / 16;
+    quint64 _h1 = seed;
+    quint64 _h2 = seed;
+    quint64 _k1, _k2;
+    // body: 16 byte blocks, read byte wise since the data is not necessarily aligned
+    const uchar* _body = reinterpret_cast<const uchar*> ( data );
+    for ( int _i=0; _i<_blocks; _i++ )
+    {
+      _k1 = qFromLittleEndian<quint64> ( _body+_i*16   );
+      _k2 = qFromLittleEndian<quint64> ( _body+_i*16+8 );
+      _k1 *= _c1; _k1 = MURMUR3_ROTL64(_k1,31); _k1 *= _c2; _h1 ^= _k1;
+      _h1 = MURMUR3_ROTL64(_h1,27); _h1 += _h2; _h1 = _h1*5+0x52dce729;
+      _k2 *= _c2; _k2 = MURMUR3_ROTL64(_k2,33); _k2 *= _c1; _h2 ^= _k2;
+      _h2 = MURMUR3_ROTL64(_h2,31); _h2 += _h1; _h2 = _h2*5+0x38495ab5;
+    }
+    // tail: the remaining 0-15 bytes
+    const unsigned char* _tail = reinterpret_cast<const unsigned char*> ( data+_blocks*16 );
+    _k1 = 0;
+    _k2 = 0;
+    switch ( length & 15 )
+    {
+      case 15: _k2 ^= quint64(_tail[14]) << 48; // fall through
+      case 14: _k2 ^= quint64(_tail[13]) << 40; // fall through
+      case 13: _k2 ^= quint64(_tail[12]) << 32; // fall through
+      case 12: _k2 ^= quint64(_tail[11]) << 24; // fall through
+      case 11: _k2 ^= quint64(_tail[10]) << 16; // fall through
+      case 10: _k2 ^= quint64(_tail[ 9]) << 8; // fall through
+      case  9: _k2 ^= quint64(_tail[ 8]) << 0;
+               _k2 *= _c2; _k2 = MURMUR3_ROTL64(_k2,33); _k2 *= _c1; _h2 ^= _k2; // fall through
+      case  8: _k1 ^= quint64(_tail[ 7]) << 56; // fall through
+      case  7: _k1 ^= quint64(_tail[ 6]) << 48; // fall through
+      case  6: _k1 ^= quint64(_tail[ 5]) << 40; // fall through
+      case  5: _k1 ^= quint64(_tail[ 4]) << 32; // fall through
+      case  4: _k1 ^= quint64(_tail[ 3]) << 24; // fall through
+      case  3: _k1 ^= quint64(_tail[ 2]) << 16; // fall through
+      case  2: _k1 ^= quint64(_tail[ 1]) << 8; // fall through
+      case  1: _k1 ^= quint64(_tail[ 0]) << 0;
+               _k1 *= _c1; _k1 = MURMUR3_ROTL64(_k1,31); _k1 *= _c2; _h1 ^= _k1;
+    }
+    // finalization
+    _h1 ^= quint64(length); _h2 ^= quint64(length);
+    _h1 += _h2; _h2 += _h1;
+    MURMUR3_FMIX64(_h1);
+    MURMUR3_FMIX64(_h2);
+    _h1 += _h2; _h2 += _h1;
+    #undef MURMUR3_FMIX64
+    #undef MURMUR3_ROTL64
+    QByteArray _hash ( 16, 0 );
+    qToLittleEndian<quint64> ( _h1, reinterpret_cast<uchar*>(_hash.data())   );
+    qToLittleEndian<quint64> ( _h2, reinterpret_cast<uchar*>(_hash.data())+8 );
+    return _hash;
+  }; // murmur3
+
+  /*!
+   * payloadHash
+   * @brief Computes the hash of a payload according to a chosen strategy.
+   * @param payload payload to be hashed
+   * @param strategy hash strategy to be used
+   * @return hex notation of the 128 bit hash (32 characters, regardless of the strategy)
+   * @author Christian Reiner
+   */
+  inline QString payloadHash ( const QString& payload, PayloadHash strategy )
+  {
+    switch ( strategy )
+    {
+      case H_MD5:
+        return QString ( QCryptographicHash::hash(payload.toUtf8(), QCryptographicHash::Md5).toHex() );
+      case H_MURMUR3:
+      default:
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+      {
+        // the hash is defined on little endian UTF-16, so the characters have to be swapped here
+        QByteArray _utf16 ( payload.size()*sizeof(QChar), 0 );
+        for ( int _i=0; _i<payload.size(); _i++ )
+          qToLittleEndian<quint16> ( payload.at(_i).unicode(), reinterpret_cast<uchar*>(_utf16.data())+_i*sizeof(QChar) );
+        return QString ( murmur3(_utf16.constData(), _utf16.size()).toHex() );
+      }
+#else
+        return QString ( murmur3(reinterpret_cast<const char*>(payload.constData()), payload.size()*sizeof(QChar)).toHex() );
+#endif
+    }
+  }; // payloadHash
+
+} // namespace KIO_CLIPBOARD
+
+#endif // UTILITY_HASH_H
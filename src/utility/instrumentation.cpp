@@ -0,0 +1,211 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Implementation of class Instrumentation
+ * @see Instrumentation
+ * @author Christian Reiner
+ */
+
+#include <stdio.h>
+#include <QCoreApplication>
+#include <QFile>
+#include <QStringList>
+#include <QtDBus/QDBusConnection>
+#include <kglobal.h>
+#include <kcomponentdata.h>
+#include <kstandarddirs.h>
+#include <kdebug.h>
+#include "utility/instrumentation.h"
+
+using namespace KIO_CLIPBOARD;
+
+// time in milliseconds between two dumps written by the timer
+static const qint64 C_dumpInterval = 5000;
+
+K_GLOBAL_STATIC ( Instrumentation, s_instrumentation )
+
+/*!
+ * Instrumentation::Histogram::Histogram
+ * @brief Constructor of an empty histogram
+ * @author Christian Reiner
+ */
+Instrumentation::Histogram::Histogram ( )
+  : count   ( 0 )
+  , total   ( 0 )
+  , maximum ( 0 )
+{
+  for ( int _bucket=0; _bucket<BUCKETS; _bucket++ )
+    buckets[_bucket] = 0;
+} // Instrumentation::Histogram::Histogram
+
+/*!
+ * Instrumentation::Histogram::percentile
+ * @brief Estimates a percentile of the recorded latencies.
+ * @param percent percentile requested, for example 99
+ * @return upper bound of the bucket holding the percentile in microseconds, never more than the maximum recorded
+ * @author Christian Reiner
+ */
+qint64 Instrumentation::Histogram::percentile ( int percent ) const
+{
+  const qint64 _rank = ( count*percent + 99 ) / 100;
+  qint64 _seen = 0;
+  for ( int _bucket=0; _bucket<BUCKETS; _bucket++ )
+  {
+    _seen += buckets[_bucket];
+    if ( 0<_seen && _seen>=_rank )
+      return qMin ( qint64(1)<<_bucket, maximum );
+  }
+  return maximum;
+} // Instrumentation::Histogram::percentile
+
+/*!
+ * Instrumentation::instance
+ * @brief Access to the one instrumentation object of this process.
+ * @return reference to the instrumentation object
+ * The object is constructed on first access, callers check isInstrumented() before.
+ * @author Christian Reiner
+ */
+Instrumentation& Instrumentation::instance ( )
+{
+  return *s_instrumentation;
+} // Instrumentation::instance
+
+/*!
+ * Instrumentation::Instrumentation
+ * @brief Constructor of class Instrumentation
+ * Works out the location of the dump file, starts the timer dumping the figures and offers the object on the session bus.
+ * @author Christian Reiner
+ */
+Instrumentation::Instrumentation ( )
+  : QObject   ( )
+  , m_dumping ( this )
+{
+  m_path = KStandardDirs::locateLocal ( "tmp", QString("%1-instrumentation-%2.txt")
+                                                 .arg(KGlobal::mainComponent().componentName())
+                                                 .arg(QCoreApplication::applicationPid()) );
+  m_dumping.setInterval ( C_dumpInterval );
+  connect ( &m_dumping, SIGNAL(timeout()), this, SLOT(dump()) );
+  m_dumping.start ( );
+  const bool _registered = QDBusConnection::sessionBus().registerObject ( "/Instrumentation", this, QDBusConnection::ExportScriptableSlots );
+  kDebug() << "instrumentation enabled, dumping to" << m_path << ", offered on dbus:" << _registered;
+} // Instrumentation::Instrumentation
+
+/*!
+ * Instrumentation::~Instrumentation
+ * @brief Destructor of class Instrumentation
+ * The object is destroyed at process exit, when KGlobal might be gone already, so nothing is dumped here.
+ * The last dump is written by the slave when it shuts down, see KIOProtocol::~KIOProtocol.
+ * @author Christian Reiner
+ */
+Instrumentation::~Instrumentation ( )
+{
+} // Instrumentation::~Instrumentation
+
+/*!
+ * Instrumentation::count
+ * @brief Adds an amount to a counter.
+ * @param counter name of the counter, created on first usage
+ * @param amount value to be added
+ * @author Christian Reiner
+ */
+void Instrumentation::count ( const QString& counter, qint64 amount )
+{
+  QMutexLocker _locker ( &m_mutex );
+  m_counters[counter] += amount;
+} // Instrumentation::count
+
+/*!
+ * Instrumentation::record
+ * @brief Records a latency sample of an operation.
+ * @param operation name of the operation, its histogram is created on first usage
+ * @param usecs latency in microseconds
+ * This is on the hot paths, so nothing but the histogram is touched, the dump file is written by the timer.
+ * @author Christian Reiner
+ */
+void Instrumentation::record ( const QString& operation, qint64 usecs )
+{
+  QMutexLocker _locker ( &m_mutex );
+  Histogram& _histogram = m_histograms[operation];
+  int _bucket = 0;
+  for ( qint64 _bound=1; _bound<=usecs && _bucket<Histogram::BUCKETS-1; _bound<<=1 )
+    ++_bucket;
+  ++_histogram.buckets[_bucket];
+  ++_histogram.count;
+  _histogram.total  += usecs;
+  _histogram.maximum = qMax ( _histogram.maximum, usecs );
+} // Instrumentation::record
+
+/*!
+ * Instrumentation::report
+ * @brief Describes all figures collected so far in plain text.
+ * @return one line per operation (count, total, mean, percentiles and maximum in microseconds) followed by one line per counter
+ * @author Christian Reiner
+ */
+QString Instrumentation::report ( ) const
+{
+  QMutexLocker _locker ( &m_mutex );
+  QStringList _lines;
+  _lines << QString("# instrumentation of process %1").arg(QCoreApplication::applicationPid());
+  _lines << QString("# %1 %2 %3 %4 %5 %6 %7 %8").arg("operation",-30).arg("count",10).arg("total[us]",12).arg("mean[us]",10)
+                                               .arg("p50[us]",10).arg("p90[us]",10).arg("p99[us]",10).arg("max[us]",10);
+  QStringList _operations = m_histograms.keys ( );
+  _operations.sort ( );
+  foreach ( const QString& _operation, _operations )
+  {
+    const Histogram& _histogram = m_histograms[_operation];
+    _lines << QString("  %1 %2 %3 %4 %5 %6 %7 %8").arg(_operation,-30).arg(_histogram.count,10).arg(_histogram.total,12)
+                                                 .arg(_histogram.count ? _histogram.total/_histogram.count : 0,10)
+                                                 .arg(_histogram.percentile(50),10).arg(_histogram.percentile(90),10)
+                                                 .arg(_histogram.percentile(99),10).arg(_histogram.maximum,10);
+  }
+  _lines << QString("# %1 %2").arg("counter",-30).arg("value",10);
+  QStringList _counters = m_counters.keys ( );
+  _counters.sort ( );
+  foreach ( const QString& _counter, _counters )
+    _lines << QString("  %1 %2").arg(_counter,-30).arg(m_counters[_counter],10);
+  return _lines.join("\n") + "\n";
+} // Instrumentation::report
+
+/*!
+ * Instrumentation::dump
+ * @brief Replaces the dump file by the current report.
+ * @return true if the file has been written
+ * The file is written aside and renamed into place, so readers never see a partial report.
+ * It is not synced to disk, a report lost in a crash of the system is of no value anyway.
+ * @author Christian Reiner
+ */
+bool Instrumentation::dump ( ) const
+{
+  const QByteArray _report = report().toUtf8 ( );
+  QFile _file ( QString("%1.new").arg(m_path) );
+  const bool _written = _file.open(QIODevice::WriteOnly|QIODevice::Truncate) && _report.size()==_file.write(_report);
+  _file.close ( );
+  // QFile::rename() refuses to replace an existing file
+  if ( ! _written || 0!=::rename(QFile::encodeName(_file.fileName()),QFile::encodeName(m_path)) )
+  {
+    kDebug() << "failed to write instrumentation dump" << m_path << _file.errorString();
+    _file.remove ( );
+    return FALSE;
+  }
+  return TRUE;
+} // Instrumentation::dump
+
+/*!
+ * Instrumentation::reset
+ * @brief Drops all figures collected so far.
+ * @author Christian Reiner
+ */
+void Instrumentation::reset ( )
+{
+  QMutexLocker _locker ( &m_mutex );
+  m_counters.clear ( );
+  m_histograms.clear ( );
+} // Instrumentation::reset
+
+#include "utility/instrumentation.moc"
@@ -0,0 +1,154 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Declaration of class Instrumentation and its helper InstrumentationTimer
+ * @see Instrumentation
+ * @author Christian Reiner
+ */
+
+#ifndef UTILITY_INSTRUMENTATION_H
+#define UTILITY_INSTRUMENTATION_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QMutex>
+#include <QTimer>
+#if QT_VERSION >= 0x040800
+#include <QElapsedTimer>
+#else
+#include <QTime>
+#endif
+
+namespace KIO_CLIPBOARD
+{
+  /*!
+   * InstrumentationClock
+   * @brief Clock used to measure latencies.
+   * QElapsedTimer offers a monotonic clock with sub-millisecond resolution from Qt 4.8 on,
+   * older versions fall back to QTime, so latencies are measured in whole milliseconds then.
+   * @see elapsedUsecs
+   */
+#if QT_VERSION >= 0x040800
+  typedef QElapsedTimer InstrumentationClock;
+  inline qint64 elapsedUsecs ( const QElapsedTimer& clock ) { return clock.nsecsElapsed() / 1000; };
+#else
+  typedef QTime InstrumentationClock;
+  inline qint64 elapsedUsecs ( const QTime& clock ) { return qint64 ( clock.elapsed() ) * 1000; };
+#endif
+
+  /*!
+   * isInstrumented
+   * @brief Tells whether instrumentation is enabled in this process.
+   * @return true if the environment variable KIO_CLIPBOARD_INSTRUMENTATION is set to a non-empty value
+   * The environment is read once, so this is cheap enough to be checked on every operation.
+   * Nothing else is done and no instrumentation object is created as long as this is false.
+   * @author Christian Reiner
+   */
+  inline bool isInstrumented ( )
+  {
+    static const bool _enabled = ! qgetenv("KIO_CLIPBOARD_INSTRUMENTATION").isEmpty();
+    return _enabled;
+  } // isInstrumented
+
+  /*!
+   * class Instrumentation
+   * @brief Per process collection of counters and latency histograms of the operations on the hot paths.
+   * Latencies are kept as histograms with buckets of doubling width in microseconds,
+   * so recording a sample is a constant effort and the memory required does not grow.
+   * The figures can be read in two ways:
+   * - over DBus, the object is registered on the session bus as /Instrumentation under the slaves unique connection name.
+   *   A slave only processes DBus requests whilst it handles a command, so this is mainly useful for long running transfers.
+   * - from a dump file written to the temporary folder, named after the slave and its process id.
+   *   The file is replaced every few seconds by a timer and when the slave shuts down, recording a sample never writes it.
+   *   The timer only fires whilst the slave processes events, that is whilst it handles a command, never whilst it is idle.
+   * There is exactly one object per process, it is created lazily on first usage.
+   * @see isInstrumented
+   * @see InstrumentationTimer
+   * @author Christian Reiner
+   */
+  class Instrumentation
+    : public QObject
+  {
+    Q_OBJECT
+    Q_CLASSINFO ( "D-Bus Interface", "org.kde.kio_clipboard.Instrumentation" )
+    private:
+      /*!
+       * Histogram
+       * @brief Latency distribution of a single operation.
+       * Bucket n counts samples of less than 2^n microseconds that did not fit into a bucket below.
+       */
+      struct Histogram
+      {
+        enum { BUCKETS = 32 };
+        qint64 count;
+        qint64 total;
+        qint64 maximum;
+        qint64 buckets[BUCKETS];
+        Histogram ( );
+        qint64 percentile ( int percent ) const;
+      };
+      mutable QMutex           m_mutex;
+      QHash<QString,qint64>    m_counters;
+      QHash<QString,Histogram> m_histograms;
+      QString                  m_path;
+      QTimer                   m_dumping;
+    public:
+      static Instrumentation& instance ( );
+      Instrumentation ( );
+      ~Instrumentation ( );
+      inline const QString& path ( ) const { return m_path; };
+      void count  ( const QString& counter, qint64 amount=1 );
+      void record ( const QString& operation, qint64 usecs );
+    public slots:
+      Q_SCRIPTABLE QString report ( ) const;
+      Q_SCRIPTABLE bool    dump   ( ) const;
+      Q_SCRIPTABLE void    reset  ( );
+  }; // class Instrumentation
+
+  /*!
+   * class InstrumentationTimer
+   * @brief Measures the latency of an operation for as long as it lives and records it when destroyed.
+   * Meant to be placed at the top of a block, so all ways of leaving the block are measured, including exceptions.
+   * Calling stop() records the latency up to that point instead, later calls and the destruction are ignored then.
+   * Nothing is measured and the name is not even assembled if instrumentation is disabled.
+   * @author Christian Reiner
+   */
+  class InstrumentationTimer
+  {
+    private:
+      QString              m_operation;
+      InstrumentationClock m_timer;
+      bool                 m_running;
+    public:
+      inline InstrumentationTimer ( const char* operation ) : m_running ( isInstrumented() )
+        { if ( m_running ) { m_operation = QLatin1String(operation); m_timer.start(); } };
+      inline InstrumentationTimer ( const char* prefix, const QString& name ) : m_running ( isInstrumented() )
+        { if ( m_running ) { m_operation = QLatin1String(prefix) + name; m_timer.start(); } };
+      inline ~InstrumentationTimer ( ) { stop(); };
+      inline void stop ( )
+        { if ( m_running ) { m_running = false; Instrumentation::instance().record ( m_operation, elapsedUsecs(m_timer) ); } };
+  }; // class InstrumentationTimer
+
+  /*!
+   * instrumentCount
+   * @brief Adds an amount to a counter, if instrumentation is enabled.
+   * @param counter name of the counter
+   * @param amount value to be added
+   * @author Christian Reiner
+   */
+  inline void instrumentCount ( const char* counter, qint64 amount=1 )
+  {
+    if ( isInstrumented() )
+      Instrumentation::instance().count ( QLatin1String(counter), amount );
+  } // instrumentCount
+
+} // namespace KIO_CLIPBOARD
+
+#endif // UTILITY_INSTRUMENTATION_H
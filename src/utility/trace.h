@@ -0,0 +1,73 @@
+/* This file is part of 'kio-clipboard'
+ * Copyright (C) 2011 Christian Reiner <kio-clipboard@christian-reiner.info>
+ *
+ * $Author$
+ * $Revision$
+ * $Date$
+ */
+
+/*!
+ * @file Declares the tracing layer used on hot paths instead of plain debug output
+ * This is a header-only library, no additional implementation file exists, thus no linking is required.
+ * @see kTrace
+ * @author Christian Reiner
+ */
+
+#ifndef UTILITY_TRACE_H
+#define UTILITY_TRACE_H
+
+#include <stdlib.h>
+#include <QByteArray>
+#include <kdebug.h>
+
+/*!
+ * KIO_CLIPBOARD_TRACE_MASK
+ * @brief Categories of tracing compiled in, set by the build system, all of them by default.
+ * Tracing of categories not contained in the mask is removed by the compiler completely.
+ */
+#ifndef KIO_CLIPBOARD_TRACE_MASK
+#define KIO_CLIPBOARD_TRACE_MASK 0xff
+#endif
+
+namespace KIO_CLIPBOARD
+{
+  /*!
+   * TraceCategory
+   * @brief Categories of tracing output, each one can be switched on and off separately.
+   * - T_DBUS: requests to and replies from clipboards
+   * - T_NODE: construction, classification and description of nodes
+   * - T_CACHE: lookups in the shared cache and in the node table
+   * - T_LIST: handling of node lists, their serialization and listings
+   * @author Christian Reiner
+   */
+  enum TraceCategory { T_DBUS=0x01, T_NODE=0x02, T_CACHE=0x04, T_LIST=0x08 };
+
+  /*!
+   * traceMask
+   * @brief Categories of tracing enabled at runtime.
+   * @return bit mask of enabled categories
+   * Read once from the environment variable KIO_CLIPBOARD_TRACE (for example "0x03"), all categories are enabled if it is not set.
+   * Output of enabled categories is still subject to the usual debug area configuration.
+   * @author Christian Reiner
+   */
+  inline int traceMask ( )
+  {
+    static const int _mask = qgetenv("KIO_CLIPBOARD_TRACE").isEmpty()
+                           ? 0xff
+                           : int ( strtol(qgetenv("KIO_CLIPBOARD_TRACE").constData(),0,0) );
+    return _mask;
+  } // traceMask
+
+} // namespace KIO_CLIPBOARD
+
+/*!
+ * kTrace
+ * @brief Debug output of a tracing category, used like kDebug().
+ * The output statement is only executed if the category is both compiled in and enabled at runtime.
+ * Otherwise nothing is evaluated, neither the arguments nor any formatting, for categories compiled out the code is dropped.
+ * The if-else construction makes this safe to be used as a single statement inside unbraced if-else statements.
+ */
+#define kTrace(category) \
+  if ( ! ( (KIO_CLIPBOARD_TRACE_MASK & (category)) && (KIO_CLIPBOARD::traceMask() & (category)) ) ) ; else kDebug()
+
+#endif // UTILITY_TRACE_H